@@ -0,0 +1,234 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QVector>
+#include "AnimationPlayer.h"
+
+class AnimationDecodeTask : public QRunnable {
+
+public:
+    AnimationDecodeTask(AnimationPlayer *animationPlayer) {
+        this->animationPlayer = animationPlayer;
+    }
+
+    void run() {
+        animationPlayer->decodeFrames();
+    }
+
+private:
+    AnimationPlayer *animationPlayer;
+};
+
+struct CachedFrame {
+    QImage image;
+    QImage scaledImage;
+    int delay;
+};
+
+/* Frames are only scaled down, the view scales up when zoomed in */
+static bool isScaledDown(const QSize &frameSize, const QSize &displaySize) {
+    return !displaySize.isEmpty() && displaySize != frameSize
+           && displaySize.width() <= frameSize.width() && displaySize.height() <= frameSize.height();
+}
+
+AnimationPlayer::AnimationPlayer(QObject *parent, const QString &imageFileName) : QObject(parent) {
+    this->imageFileName = imageFileName;
+    QImageReader imageReader(imageFileName);
+    imageSize = imageReader.size();
+    stopping = false;
+    waitingForFrame = false;
+    nextFrameTime = 0;
+
+    threadPool.setMaxThreadCount(1);
+
+    frameTimer = new QTimer(this);
+    frameTimer->setSingleShot(true);
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer, SIGNAL(timeout()), this, SLOT(showNextFrame()));
+}
+
+AnimationPlayer::~AnimationPlayer() {
+    mutex.lock();
+    stopping = true;
+    ringNotFull.wakeAll();
+    mutex.unlock();
+    threadPool.waitForDone();
+}
+
+bool AnimationPlayer::isAnimated(QImageReader &imageReader) {
+    return imageReader.supportsAnimation() && imageReader.imageCount() > 1;
+}
+
+void AnimationPlayer::start() {
+    clock.start();
+    waitingForFrame = true;
+    threadPool.start(new AnimationDecodeTask(this));
+}
+
+QSize AnimationPlayer::getImageSize() const {
+    return imageSize;
+}
+
+void AnimationPlayer::setDisplaySize(const QSize &displaySize) {
+    QMutexLocker locker(&mutex);
+    this->displaySize = displaySize;
+}
+
+QSize AnimationPlayer::getDisplaySize() {
+    QMutexLocker locker(&mutex);
+    return displaySize;
+}
+
+/* Runs on the worker thread, returns false when the player is going away */
+bool AnimationPlayer::queueFrame(const QImage &image, int delay) {
+    QMutexLocker locker(&mutex);
+    while (frameRing.size() >= ANIMATION_FRAME_RING_SIZE && !stopping) {
+        ringNotFull.wait(&mutex);
+    }
+    if (stopping) {
+        return false;
+    }
+
+    Frame frame;
+    frame.image = image;
+    frame.delay = delay;
+    frameRing.enqueue(frame);
+    if (frameRing.size() == 1) {
+        QMetaObject::invokeMethod(this, "onFrameDecoded", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+/* Runs on the worker thread */
+void AnimationPlayer::decodeFrames() {
+    QImageReader imageReader(imageFileName);
+    int loopCount = imageReader.loopCount();
+    int loopsPlayed = 0;
+    int frameIndex = 0;
+    QVector<CachedFrame> cachedFrames;
+    qint64 cachedBytes = 0;
+    bool cacheUsable = true;
+    bool cacheComplete = false;
+
+    for (;;) {
+        QImage image;
+        bool endOfLoop;
+        if (cacheComplete) {
+            endOfLoop = frameIndex == cachedFrames.size();
+        } else {
+            endOfLoop = !imageReader.read(&image);
+        }
+
+        if (endOfLoop) {
+            /* Nothing readable, or played as many times as the file asks for */
+            ++loopsPlayed;
+            if (frameIndex == 0 || (loopCount != -1 && loopsPlayed > loopCount)) {
+                return;
+            }
+
+            if (cacheUsable) {
+                cacheComplete = true;
+            } else {
+                imageReader.setFileName(imageFileName);
+            }
+            frameIndex = 0;
+            continue;
+        }
+
+        QSize scaledSize = getDisplaySize();
+        int delay;
+        if (cacheComplete) {
+            CachedFrame &cachedFrame = cachedFrames[frameIndex];
+            image = cachedFrame.image;
+            delay = cachedFrame.delay;
+            if (isScaledDown(image.size(), scaledSize)) {
+                if (cachedFrame.scaledImage.size() != scaledSize) {
+                    cachedFrame.scaledImage = image.scaled(scaledSize, Qt::IgnoreAspectRatio,
+                                                           Qt::SmoothTransformation);
+                }
+                image = cachedFrame.scaledImage;
+            }
+        } else {
+            /* Same rule as browsers, very short delays mean the file did not set one */
+            delay = imageReader.nextImageDelay();
+            if (delay < ANIMATION_MIN_FRAME_DELAY) {
+                delay = ANIMATION_DEFAULT_FRAME_DELAY;
+            }
+
+            image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            if (cacheUsable) {
+                cachedBytes += (qint64) image.bytesPerLine() * image.height();
+                if (cachedBytes > (qint64) ANIMATION_CACHE_BUDGET_MB * 1024 * 1024) {
+                    cacheUsable = false;
+                    cachedFrames.clear();
+                } else {
+                    CachedFrame cachedFrame;
+                    cachedFrame.image = image;
+                    cachedFrame.delay = delay;
+                    cachedFrames.append(cachedFrame);
+                }
+            }
+
+            if (isScaledDown(image.size(), scaledSize)) {
+                image = image.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                if (cacheUsable) {
+                    cachedFrames.last().scaledImage = image;
+                }
+            }
+        }
+        ++frameIndex;
+
+        if (!queueFrame(image, delay)) {
+            return;
+        }
+    }
+}
+
+void AnimationPlayer::onFrameDecoded() {
+    if (waitingForFrame) {
+        waitingForFrame = false;
+        nextFrameTime = clock.elapsed();
+        showNextFrame();
+    }
+}
+
+void AnimationPlayer::showNextFrame() {
+    Frame frame;
+    {
+        QMutexLocker locker(&mutex);
+        if (frameRing.isEmpty()) {
+            /* The worker is behind, or the animation is over */
+            waitingForFrame = true;
+            return;
+        }
+        frame = frameRing.dequeue();
+        ringNotFull.wakeOne();
+    }
+
+    emit frameChanged(frame.image);
+
+    /* Due times accumulate, a frame shown late shortens the wait for the next one */
+    nextFrameTime += frame.delay;
+    qint64 wait = nextFrameTime - clock.elapsed();
+    if (wait < -frame.delay) {
+        nextFrameTime = clock.elapsed();
+        wait = 0;
+    }
+    frameTimer->start((int) qMax(wait, (qint64) 0));
+}
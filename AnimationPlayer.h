@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIMATION_PLAYER_H
+#define ANIMATION_PLAYER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QImageReader>
+#include <QString>
+
+#define ANIMATION_FRAME_RING_SIZE 8
+#define ANIMATION_CACHE_BUDGET_MB 64
+#define ANIMATION_MIN_FRAME_DELAY 20
+#define ANIMATION_DEFAULT_FRAME_DELAY 100
+
+/*
+ * Plays GIF, WebP and other animated images. A worker decodes frames ahead into a small ring,
+ * already scaled down to the size they are shown at, and the GUI thread only swaps in the next
+ * frame when it is due. Due times accumulate on a running clock, so decoding and event delays
+ * do not add up over a loop. Animations small enough to fit the cache budget are decoded once.
+ */
+class AnimationPlayer : public QObject {
+Q_OBJECT
+
+public:
+    AnimationPlayer(QObject *parent, const QString &imageFileName);
+
+    ~AnimationPlayer();
+
+    /* More than one frame to play */
+    static bool isAnimated(QImageReader &imageReader);
+
+    void start();
+
+    /* Size of the frames in the file */
+    QSize getImageSize() const;
+
+    /* Frames decoded from now on are scaled down to this size */
+    void setDisplaySize(const QSize &displaySize);
+
+    void decodeFrames();
+
+signals:
+
+    void frameChanged(const QImage &frame);
+
+private slots:
+
+    void showNextFrame();
+
+    void onFrameDecoded();
+
+private:
+    struct Frame {
+        QImage image;
+        int delay;
+    };
+
+    QString imageFileName;
+    QSize imageSize;
+    QThreadPool threadPool;
+    QMutex mutex;
+    QWaitCondition ringNotFull;
+    QQueue<Frame> frameRing;
+    QSize displaySize;
+    bool stopping;
+    bool waitingForFrame;
+    QTimer *frameTimer;
+    QElapsedTimer clock;
+    qint64 nextFrameTime;
+
+    QSize getDisplaySize();
+
+    bool queueFrame(const QImage &image, int delay);
+};
+
+#endif // ANIMATION_PLAYER_H
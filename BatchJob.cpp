@@ -0,0 +1,131 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QThread>
+#include "BatchJob.h"
+
+class BatchJobTask : public QRunnable {
+
+public:
+    BatchJobTask(BatchJob *batchJob, const QString &fileName) {
+        this->batchJob = batchJob;
+        this->fileName = fileName;
+    }
+
+    void run() {
+        batchJob->runTask(fileName);
+    }
+
+private:
+    BatchJob *batchJob;
+    QString fileName;
+};
+
+BatchJob::BatchJob(QObject *parent, const QStringList &fileList, Task task, int maxThreads) : QObject(parent) {
+    this->fileList = fileList;
+    this->task = task;
+    if (maxThreads <= 0) {
+        maxThreads = qMin(BATCH_JOB_MAX_THREADS, QThread::idealThreadCount());
+    }
+    threadPool.setMaxThreadCount(qMax(1, maxThreads));
+    doneCount = 0;
+    running = false;
+}
+
+BatchJob::~BatchJob() {
+    cancel();
+    threadPool.waitForDone();
+}
+
+void BatchJob::start() {
+    running = true;
+
+    if (fileList.isEmpty()) {
+        running = false;
+        emit finished();
+        return;
+    }
+
+    for (int i = 0; i < fileList.size(); ++i) {
+        threadPool.start(new BatchJobTask(this, fileList.at(i)));
+    }
+}
+
+/* Runs on a worker thread */
+void BatchJob::runTask(const QString &fileName) {
+    QString errorString;
+    bool skipped = cancelled.load();
+    bool success = false;
+
+    if (!skipped) {
+        success = task(fileName, errorString);
+    }
+
+    QMetaObject::invokeMethod(this, "onTaskDone", Qt::QueuedConnection, Q_ARG(QString, fileName),
+                              Q_ARG(bool, skipped), Q_ARG(bool, success), Q_ARG(QString, errorString));
+}
+
+void BatchJob::onTaskDone(QString fileName, bool skipped, bool success, QString errorString) {
+    ++doneCount;
+
+    if (!skipped) {
+        if (success) {
+            succeededFiles.append(fileName);
+        } else {
+            failedFiles.append(fileName);
+            errors.append(errorString);
+        }
+        emit fileDone(fileName, success, errorString);
+    }
+
+    emit progress(doneCount, fileList.size());
+
+    if (doneCount == fileList.size()) {
+        running = false;
+        emit finished();
+    }
+}
+
+void BatchJob::cancel() {
+    cancelled.store(1);
+}
+
+bool BatchJob::isRunning() {
+    return running;
+}
+
+bool BatchJob::isCancelled() {
+    return cancelled.load();
+}
+
+const QStringList &BatchJob::getFileList() {
+    return fileList;
+}
+
+const QStringList &BatchJob::getSucceededFiles() {
+    return succeededFiles;
+}
+
+const QStringList &BatchJob::getFailedFiles() {
+    return failedFiles;
+}
+
+const QStringList &BatchJob::getErrors() {
+    return errors;
+}
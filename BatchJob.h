@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_JOB_H
+#define BATCH_JOB_H
+
+#include <functional>
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QStringList>
+
+#define BATCH_JOB_MAX_THREADS 4
+
+/*
+ * Runs a task for every file of a list on a bounded pool of worker threads.
+ * The task returns false and fills errorString when a file fails; progress and
+ * the final result are reported on the thread that owns the job. A thread count
+ * of 0 picks up to BATCH_JOB_MAX_THREADS depending on the machine.
+ */
+class BatchJob : public QObject {
+Q_OBJECT
+
+public:
+    typedef std::function<bool(const QString &fileName, QString &errorString)> Task;
+
+    BatchJob(QObject *parent, const QStringList &fileList, Task task, int maxThreads = 0);
+
+    ~BatchJob();
+
+    void start();
+
+    bool isRunning();
+
+    bool isCancelled();
+
+    const QStringList &getFileList();
+
+    const QStringList &getSucceededFiles();
+
+    const QStringList &getFailedFiles();
+
+    const QStringList &getErrors();
+
+    void runTask(const QString &fileName);
+
+public slots:
+
+    void cancel();
+
+signals:
+
+    void progress(int doneCount, int totalCount);
+
+    void fileDone(QString fileName, bool success, QString errorString);
+
+    void finished();
+
+private:
+    QThreadPool threadPool;
+    QAtomicInt cancelled;
+    QStringList fileList;
+    QStringList succeededFiles;
+    QStringList failedFiles;
+    QStringList errors;
+    Task task;
+    int doneCount;
+    bool running;
+
+private slots:
+
+    void onTaskDone(QString fileName, bool skipped, bool success, QString errorString);
+};
+
+#endif // BATCH_JOB_H
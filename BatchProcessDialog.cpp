@@ -0,0 +1,229 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchProcessDialog.h"
+#include "MessageBox.h"
+#include "Settings.h"
+
+BatchProcessDialog::BatchProcessDialog(QWidget *parent, const QStringList &fileList) : QDialog(parent) {
+    this->fileList = fileList;
+    setWindowTitle(tr("Batch Process"));
+    setWindowIcon(QIcon(":/images/phototonic.png"));
+
+    if (Settings::dialogLastX) {
+        move(Settings::dialogLastX, Settings::dialogLastY);
+    }
+
+    /* The edits currently set up in the viewer */
+    QString rotationString = QString::number(Settings::rotation) + QString::fromUtf8("°");
+    if (Settings::flipH) {
+        rotationString += ", " + tr("flipped horizontally");
+    }
+    if (Settings::flipV) {
+        rotationString += ", " + tr("flipped vertically");
+    }
+    rotationCheckBox = new QCheckBox(tr("Rotation and flips (%1)").arg(rotationString));
+    rotationCheckBox->setChecked(Settings::rotation || Settings::flipH || Settings::flipV);
+    cropCheckBox = new QCheckBox(tr("Crop (%1% left, %2% top, %3% right, %4% bottom)")
+                                         .arg(Settings::cropLeftPercent).arg(Settings::cropTopPercent)
+                                         .arg(Settings::cropWidthPercent).arg(Settings::cropHeightPercent));
+    cropCheckBox->setChecked(Settings::cropLeftPercent || Settings::cropTopPercent
+                             || Settings::cropWidthPercent || Settings::cropHeightPercent);
+    colorsCheckBox = new QCheckBox(tr("Color adjustments"));
+    colorsCheckBox->setChecked(Settings::colorsActive || Settings::keepTransform);
+    exifOrientationCheckBox = new QCheckBox(tr("Apply Exif orientation"));
+    exifOrientationCheckBox->setChecked(Settings::exifRotationEnabled);
+
+    QVBoxLayout *editsVbox = new QVBoxLayout;
+    editsVbox->addWidget(rotationCheckBox);
+    editsVbox->addWidget(cropCheckBox);
+    editsVbox->addWidget(colorsCheckBox);
+    editsVbox->addWidget(exifOrientationCheckBox);
+    QGroupBox *editsGroupBox = new QGroupBox(tr("Edits"));
+    editsGroupBox->setLayout(editsVbox);
+
+    scaleNoneRadioButton = new QRadioButton(tr("Keep size"));
+    scalePercentRadioButton = new QRadioButton(tr("Percent:"));
+    scaleFitRadioButton = new QRadioButton(tr("Fit within:"));
+    scaleNoneRadioButton->setChecked(true);
+    connect(scaleNoneRadioButton, SIGNAL(clicked()), this, SLOT(updateControls()));
+    connect(scalePercentRadioButton, SIGNAL(clicked()), this, SLOT(updateControls()));
+    connect(scaleFitRadioButton, SIGNAL(clicked()), this, SLOT(updateControls()));
+
+    scalePercentSpinBox = new QSpinBox;
+    scalePercentSpinBox->setRange(1, 1000);
+    scalePercentSpinBox->setValue(50);
+    scalePercentSpinBox->setSuffix(" %");
+    fitWidthSpinBox = new QSpinBox;
+    fitWidthSpinBox->setRange(1, 65535);
+    fitWidthSpinBox->setValue(1920);
+    fitHeightSpinBox = new QSpinBox;
+    fitHeightSpinBox->setRange(1, 65535);
+    fitHeightSpinBox->setValue(1080);
+
+    QGridLayout *scaleGbox = new QGridLayout;
+    scaleGbox->addWidget(scaleNoneRadioButton, 0, 0, 1, 1);
+    scaleGbox->addWidget(scalePercentRadioButton, 1, 0, 1, 1);
+    scaleGbox->addWidget(scalePercentSpinBox, 1, 1, 1, 1);
+    scaleGbox->addWidget(scaleFitRadioButton, 2, 0, 1, 1);
+    scaleGbox->addWidget(fitWidthSpinBox, 2, 1, 1, 1);
+    scaleGbox->addWidget(new QLabel("x"), 2, 2, 1, 1);
+    scaleGbox->addWidget(fitHeightSpinBox, 2, 3, 1, 1);
+    scaleGbox->setColumnStretch(4, 1);
+    QGroupBox *scaleGroupBox = new QGroupBox(tr("Scale"));
+    scaleGroupBox->setLayout(scaleGbox);
+
+    formatComboBox = new QComboBox;
+    formatComboBox->addItem(tr("Keep format"));
+    QStringList formats;
+    formats << "jpg" << "png" << "tif" << "bmp" << "webp";
+    QList<QByteArray> supportedFormats = QImageWriter::supportedImageFormats();
+    for (int i = 0; i < formats.size(); ++i) {
+        if (supportedFormats.contains(formats.at(i).toLatin1())) {
+            formatComboBox->addItem(formats.at(i).toUpper(), formats.at(i));
+        }
+    }
+    connect(formatComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(updateControls()));
+
+    qualitySpinBox = new QSpinBox;
+    qualitySpinBox->setRange(0, 100);
+    qualitySpinBox->setValue(Settings::defaultSaveQuality);
+
+    outputDirectoryLineEdit = new QLineEdit;
+    outputDirectoryLineEdit->setPlaceholderText(tr("Next to the original images"));
+    QPushButton *browseButton = new QPushButton(tr("Browse..."));
+    connect(browseButton, SIGNAL(clicked()), this, SLOT(browseOutputDirectory()));
+    /* By default the results never land on the originals */
+    nameSuffixLineEdit = new QLineEdit("_edited");
+    nameSuffixLineEdit->setPlaceholderText(tr("Keep the original names"));
+    overwriteCheckBox = new QCheckBox(tr("Overwrite existing files"));
+
+    QGridLayout *outputGbox = new QGridLayout;
+    outputGbox->addWidget(new QLabel(tr("Format:")), 0, 0, 1, 1);
+    outputGbox->addWidget(formatComboBox, 0, 1, 1, 1);
+    outputGbox->addWidget(new QLabel(tr("Quality:")), 1, 0, 1, 1);
+    outputGbox->addWidget(qualitySpinBox, 1, 1, 1, 1);
+    outputGbox->addWidget(new QLabel(tr("Directory:")), 2, 0, 1, 1);
+    outputGbox->addWidget(outputDirectoryLineEdit, 2, 1, 1, 2);
+    outputGbox->addWidget(browseButton, 2, 3, 1, 1);
+    outputGbox->addWidget(new QLabel(tr("Name suffix:")), 3, 0, 1, 1);
+    outputGbox->addWidget(nameSuffixLineEdit, 3, 1, 1, 1);
+    outputGbox->addWidget(overwriteCheckBox, 4, 0, 1, 4);
+    outputGbox->setColumnStretch(2, 1);
+    QGroupBox *outputGroupBox = new QGroupBox(tr("Output"));
+    outputGroupBox->setLayout(outputGbox);
+
+    QHBoxLayout *buttonsHbox = new QHBoxLayout;
+    QPushButton *okButton = new QPushButton(tr("Process %n image(s)", "", fileList.size()));
+    connect(okButton, SIGNAL(clicked()), this, SLOT(ok()));
+    okButton->setDefault(true);
+    QPushButton *cancelButton = new QPushButton(tr("Cancel"));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(abort()));
+    buttonsHbox->addWidget(cancelButton, 1, Qt::AlignRight);
+    buttonsHbox->addWidget(okButton, 0, Qt::AlignRight);
+
+    QVBoxLayout *mainVbox = new QVBoxLayout;
+    mainVbox->addWidget(editsGroupBox);
+    mainVbox->addWidget(scaleGroupBox);
+    mainVbox->addWidget(outputGroupBox);
+    mainVbox->addLayout(buttonsHbox);
+    setLayout(mainVbox);
+
+    updateControls();
+}
+
+void BatchProcessDialog::updateControls() {
+    scalePercentSpinBox->setEnabled(scalePercentRadioButton->isChecked());
+    fitWidthSpinBox->setEnabled(scaleFitRadioButton->isChecked());
+    fitHeightSpinBox->setEnabled(scaleFitRadioButton->isChecked());
+}
+
+void BatchProcessDialog::browseOutputDirectory() {
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Choose Directory"),
+                                                          outputDirectoryLineEdit->text().isEmpty()
+                                                          ? Settings::currentDirectory
+                                                          : outputDirectoryLineEdit->text());
+    if (!directory.isEmpty()) {
+        outputDirectoryLineEdit->setText(directory);
+    }
+}
+
+BatchProcessor::Options BatchProcessDialog::getOptions() {
+    BatchProcessor::Options options;
+    options.parameters = ImageProcessor::getParameters(0);
+    if (!rotationCheckBox->isChecked()) {
+        options.parameters.rotation = 0;
+        options.parameters.flipH = options.parameters.flipV = false;
+    }
+    if (!cropCheckBox->isChecked()) {
+        options.parameters.cropLeftPercent = options.parameters.cropTopPercent = 0;
+        options.parameters.cropWidthPercent = options.parameters.cropHeightPercent = 0;
+    }
+    options.parameters.applyColors = colorsCheckBox->isChecked();
+    options.applyExifOrientation = exifOrientationCheckBox->isChecked();
+
+    if (scalePercentRadioButton->isChecked()) {
+        options.scaleMode = BatchProcessor::ScalePercent;
+    } else if (scaleFitRadioButton->isChecked()) {
+        options.scaleMode = BatchProcessor::ScaleFit;
+    } else {
+        options.scaleMode = BatchProcessor::ScaleNone;
+    }
+    options.scalePercent = scalePercentSpinBox->value();
+    options.fitSize = QSize(fitWidthSpinBox->value(), fitHeightSpinBox->value());
+
+    options.format = formatComboBox->currentData().toString().toLatin1();
+    options.quality = qualitySpinBox->value();
+    options.outputDirectory = outputDirectoryLineEdit->text().trimmed();
+    options.nameSuffix = nameSuffixLineEdit->text().trimmed();
+    options.overwrite = overwriteCheckBox->isChecked();
+    return options;
+}
+
+void BatchProcessDialog::ok() {
+    QString outputDirectory = outputDirectoryLineEdit->text().trimmed();
+    if (!outputDirectory.isEmpty() && !QDir(outputDirectory).exists()) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("The output directory does not exist."));
+        return;
+    }
+
+    BatchProcessor::Options options = getOptions();
+    QStringList conflictingOutputs = BatchProcessor::getConflictingOutputs(fileList, options);
+    if (!conflictingOutputs.isEmpty()) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("%n output file(s) would be saved from more than one image or over another "
+                                        "selected image, such as %1. Choose a format or a name suffix that "
+                                        "keeps them apart.", "", conflictingOutputs.size())
+                .arg(QFileInfo(conflictingOutputs.first()).fileName()));
+        return;
+    }
+
+    if (!options.overwrite && BatchProcessor::replacesSources(fileList, options)) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("The output files would replace the original images. Set a name suffix "
+                                        "or an output directory, or allow overwriting existing files."));
+        return;
+    }
+
+    accept();
+}
+
+void BatchProcessDialog::abort() {
+    reject();
+}
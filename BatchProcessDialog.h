@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_PROCESS_DIALOG_H
+#define BATCH_PROCESS_DIALOG_H
+
+#include <QtWidgets>
+#include "BatchProcessor.h"
+
+class BatchProcessDialog : public QDialog {
+Q_OBJECT
+
+public:
+    BatchProcessDialog(QWidget *parent, const QStringList &fileList);
+
+    BatchProcessor::Options getOptions();
+
+public slots:
+
+    void ok();
+
+    void abort();
+
+    void browseOutputDirectory();
+
+    void updateControls();
+
+private:
+    QCheckBox *rotationCheckBox;
+    QCheckBox *cropCheckBox;
+    QCheckBox *colorsCheckBox;
+    QCheckBox *exifOrientationCheckBox;
+    QRadioButton *scaleNoneRadioButton;
+    QRadioButton *scalePercentRadioButton;
+    QRadioButton *scaleFitRadioButton;
+    QSpinBox *scalePercentSpinBox;
+    QSpinBox *fitWidthSpinBox;
+    QSpinBox *fitHeightSpinBox;
+    QComboBox *formatComboBox;
+    QSpinBox *qualitySpinBox;
+    QLineEdit *outputDirectoryLineEdit;
+    QLineEdit *nameSuffixLineEdit;
+    QCheckBox *overwriteCheckBox;
+    QStringList fileList;
+};
+
+#endif // BATCH_PROCESS_DIALOG_H
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSet>
+#include "BatchProcessor.h"
+#include "ImageSaver.h"
+#include "MetadataCache.h"
+#include "OrientationKernel.h"
+
+QString BatchProcessor::getOutputFileName(const QString &fileName, const Options &options) {
+    QFileInfo fileInfo(fileName);
+    QString directory = options.outputDirectory.isEmpty() ? fileInfo.absolutePath() : options.outputDirectory;
+    QString suffix = options.format.isEmpty() ? fileInfo.suffix() : QString::fromLatin1(options.format);
+    return QDir(directory).filePath(fileInfo.completeBaseName() + options.nameSuffix + "." + suffix);
+}
+
+/* Checked before a job starts, since the workers would otherwise overwrite each other's results or inputs */
+QStringList BatchProcessor::getConflictingOutputs(const QStringList &fileList, const Options &options) {
+    QSet<QString> inputFiles;
+    for (int file = 0; file < fileList.size(); ++file) {
+        inputFiles.insert(QFileInfo(fileList[file]).absoluteFilePath());
+    }
+
+    QSet<QString> outputFiles;
+    QStringList conflictingOutputs;
+    for (int file = 0; file < fileList.size(); ++file) {
+        QString inputFileName = QFileInfo(fileList[file]).absoluteFilePath();
+        QString outputFileName = QFileInfo(getOutputFileName(fileList[file], options)).absoluteFilePath();
+        bool replacesOtherInput = outputFileName != inputFileName && inputFiles.contains(outputFileName);
+        if ((outputFiles.contains(outputFileName) || replacesOtherInput)
+            && !conflictingOutputs.contains(outputFileName)) {
+            conflictingOutputs.append(outputFileName);
+        }
+        outputFiles.insert(outputFileName);
+    }
+
+    return conflictingOutputs;
+}
+
+bool BatchProcessor::replacesSources(const QStringList &fileList, const Options &options) {
+    for (int file = 0; file < fileList.size(); ++file) {
+        if (QFileInfo(getOutputFileName(fileList[file], options)).absoluteFilePath()
+            == QFileInfo(fileList[file]).absoluteFilePath()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Runs on batch job threads */
+bool BatchProcessor::processImage(const QString &fileName, const Options &options, QString &errorString) {
+    QString outputFileName = getOutputFileName(fileName, options);
+    if (!options.overwrite && QFileInfo(outputFileName).exists()) {
+        errorString = QObject::tr("File already exists");
+        return false;
+    }
+
+    QImageReader imageReader(fileName);
+    QImage image;
+    if (!imageReader.read(&image)) {
+        errorString = imageReader.errorString();
+        return false;
+    }
+
+    ImageProcessor::Parameters parameters = options.parameters;
+    parameters.exifOrientation = 0;
+    if (options.applyExifOrientation) {
+        parameters.exifOrientation = MetadataCache::readImageOrientation(fileName);
+    }
+
+    /* Scaling comes first in the pipeline, so it is given in stored pixels */
+    parameters.scaledWidth = parameters.scaledHeight = 0;
+    parameters.cropLeft = parameters.cropTop = parameters.cropWidth = parameters.cropHeight = 0;
+    QSize scaledSize = image.size();
+    if (options.scaleMode == ScalePercent) {
+        scaledSize = QSize(qMax(1, image.width() * options.scalePercent / 100),
+                           qMax(1, image.height() * options.scalePercent / 100));
+    } else if (options.scaleMode == ScaleFit) {
+        QSize transformedSize;
+        QTransform matrix = ImageProcessor::getTransform(image.size(), parameters, transformedSize);
+        QSize fitSize = OrientationKernel::getOrientation(matrix) >= 5 ? options.fitSize.transposed() : options.fitSize;
+        if (image.width() > fitSize.width() || image.height() > fitSize.height()) {
+            scaledSize = image.size().scaled(fitSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+        }
+    }
+    if (scaledSize != image.size()) {
+        parameters.scaledWidth = scaledSize.width();
+        parameters.scaledHeight = scaledSize.height();
+    }
+
+    ImageSaver::Request request;
+    request.image = ImageProcessor::process(image, parameters);
+    request.sourceFileName = fileName;
+    request.fileName = outputFileName;
+    request.format = options.format;
+    request.quality = options.quality;
+    request.resetOrientation = parameters.exifOrientation > 1;
+    ImageSaver::setLosslessTransform(request, image.size(), parameters);
+
+    if (request.image.isNull()) {
+        errorString = QObject::tr("Nothing left after cropping");
+        return false;
+    }
+
+    bool metadataSaved;
+    return ImageSaver::saveImage(request, errorString, metadataSaved);
+}
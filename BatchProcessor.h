@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_PROCESSOR_H
+#define BATCH_PROCESSOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QSize>
+#include "ImageProcessor.h"
+
+/*
+ * Applies the viewer's edits to image files, for batch jobs. Every file is decoded,
+ * processed and saved through ImageSaver on the calling thread, so its metadata is
+ * kept and a JPEG that is only rotated or cropped is transformed losslessly.
+ */
+class BatchProcessor {
+
+public:
+    enum ScaleModes {
+        ScaleNone = 0,
+        ScalePercent,
+        ScaleFit
+    };
+
+    struct Options {
+        /* Rotation, flips, crop percentages and colors, pixel sizes are set per image */
+        ImageProcessor::Parameters parameters;
+        bool applyExifOrientation;
+        int scaleMode;
+        int scalePercent;
+        /* Larger images are scaled down to fit, smaller ones are left as they are */
+        QSize fitSize;
+        /* Empty to keep the format of each file */
+        QByteArray format;
+        int quality;
+        /* Empty to save next to the source */
+        QString outputDirectory;
+        /* Appended to the base name, empty to keep it */
+        QString nameSuffix;
+        bool overwrite;
+    };
+
+    static QString getOutputFileName(const QString &fileName, const Options &options);
+
+    /* Output files that more than one of the files would be saved to, or that are another one of the files */
+    static QStringList getConflictingOutputs(const QStringList &fileList, const Options &options);
+
+    /* True when some file would be saved over itself */
+    static bool replacesSources(const QStringList &fileList, const Options &options);
+
+    static bool processImage(const QString &fileName, const Options &options, QString &errorString);
+};
+
+#endif // BATCH_PROCESSOR_H
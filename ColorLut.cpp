@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QMutex>
+#include "ColorLut.h"
+#include "ColorizeKernel.h"
+
+static QMutex cacheMutex;
+static QSharedPointer<ColorLut> cachedColorLut;
+static ImageProcessor::Parameters countedParameters;
+static qint64 countedPixels = 0;
+
+ColorLut::ColorLut(const ImageProcessor::Parameters &parameters) {
+    this->parameters = parameters;
+
+    table = QImage(4096, 4096, QImage::Format_RGB32);
+    QRgb *entries = (QRgb *) table.bits();
+    for (int i = 0; i < COLOR_LUT_ENTRIES; ++i) {
+        entries[i] = 0xff000000 | i;
+    }
+
+    ColorizeKernel colorizeKernel(parameters);
+    colorizeKernel.apply(table);
+}
+
+bool ColorLut::hasSameColors(const ImageProcessor::Parameters &parameters,
+                             const ImageProcessor::Parameters &otherParameters) {
+    return parameters.colorizeEnabled == otherParameters.colorizeEnabled
+           && parameters.hueVal == otherParameters.hueVal
+           && parameters.saturationVal == otherParameters.saturationVal
+           && parameters.lightnessVal == otherParameters.lightnessVal
+           && parameters.contrastVal == otherParameters.contrastVal
+           && parameters.brightVal == otherParameters.brightVal
+           && parameters.redVal == otherParameters.redVal
+           && parameters.greenVal == otherParameters.greenVal
+           && parameters.blueVal == otherParameters.blueVal
+           && parameters.rNegateEnabled == otherParameters.rNegateEnabled
+           && parameters.gNegateEnabled == otherParameters.gNegateEnabled
+           && parameters.bNegateEnabled == otherParameters.bNegateEnabled
+           && parameters.hueRedChannel == otherParameters.hueRedChannel
+           && parameters.hueGreenChannel == otherParameters.hueGreenChannel
+           && parameters.hueBlueChannel == otherParameters.hueBlueChannel;
+}
+
+QSharedPointer<ColorLut> ColorLut::find(const ImageProcessor::Parameters &parameters, qint64 pixelCount) {
+    QMutexLocker locker(&cacheMutex);
+
+    if (cachedColorLut && hasSameColors(cachedColorLut->parameters, parameters)) {
+        return cachedColorLut;
+    }
+
+    if (countedPixels && hasSameColors(countedParameters, parameters)) {
+        countedPixels += pixelCount;
+    } else {
+        /* New settings, the table of the old ones is not going to be used again */
+        cachedColorLut.clear();
+        countedParameters = parameters;
+        countedPixels = pixelCount;
+    }
+
+    if (countedPixels < COLOR_LUT_ENTRIES) {
+        return QSharedPointer<ColorLut>();
+    }
+
+    cachedColorLut = QSharedPointer<ColorLut>(new ColorLut(parameters));
+    return cachedColorLut;
+}
+
+void ColorLut::release() {
+    QMutexLocker locker(&cacheMutex);
+    cachedColorLut.clear();
+    countedPixels = 0;
+}
+
+void ColorLut::apply(QImage &image, int threadCount) const {
+    ColorizeKernel::processBands(image, threadCount,
+                                 [this](uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) {
+                                     processLines(bits, bytesPerLine, width, firstLine, lastLine);
+                                 });
+}
+
+void ColorLut::processLines(uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) const {
+    const QRgb *entries = (const QRgb *) table.constBits();
+    for (int y = firstLine; y <= lastLine; ++y) {
+        QRgb *line = (QRgb *) (bits + (qint64) y * bytesPerLine);
+        for (int x = 0; x < width; ++x) {
+            line[x] = (entries[line[x] & 0xffffff] & 0xffffff) | (line[x] & 0xff000000);
+        }
+    }
+}
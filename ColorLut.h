@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <QImage>
+#include <QSharedPointer>
+#include "ImageProcessor.h"
+
+#define COLOR_LUT_ENTRIES (256 * 256 * 256)
+
+/*
+ * The color adjustments baked into a table with one entry per RGB value, so that applying
+ * them costs a single lookup per pixel. Building the table costs as much as colorizing a
+ * 16MP image, so one is only built once that many pixels were adjusted with the same
+ * settings, on one large image or across images (kept transformations, slideshows, batches).
+ */
+class ColorLut {
+
+public:
+    ColorLut(const ImageProcessor::Parameters &parameters);
+
+    /* Returns the table for these settings, or null while building one does not pay off yet */
+    static QSharedPointer<ColorLut> find(const ImageProcessor::Parameters &parameters, qint64 pixelCount);
+
+    /* Frees the cached table */
+    static void release();
+
+    static bool hasSameColors(const ImageProcessor::Parameters &parameters,
+                              const ImageProcessor::Parameters &otherParameters);
+
+    /* Split in bands on the pool of ColorizeKernel, a threadCount of 0 uses every core */
+    void apply(QImage &image, int threadCount = 0) const;
+
+    void processLines(uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) const;
+
+private:
+    ImageProcessor::Parameters parameters;
+
+    /* 4096x4096, the pixel at index i holds the adjusted color of RGB value i */
+    QImage table;
+};
+
+#endif // COLOR_LUT_H
@@ -0,0 +1,402 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <cmath>
+#include "ColorizeKernel.h"
+
+#define ROUND(x) ((int) ((x) + 0.5))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Sized once, the calling thread always takes a band itself */
+class BandThreadPool : public QThreadPool {
+
+public:
+    BandThreadPool() {
+        setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    }
+};
+
+Q_GLOBAL_STATIC(BandThreadPool, bandThreadPool)
+
+static inline int bound0To255(int val) {
+    return ((val > 255) ? 255 : (val < 0) ? 0 : val);
+}
+
+static inline int hslValue(double n1, double n2, double hue) {
+    double value;
+
+    if (hue > 255) {
+        hue -= 255;
+    } else if (hue < 0) {
+        hue += 255;
+    }
+
+    if (hue < 42.5) {
+        value = n1 + (n2 - n1) * (hue / 42.5);
+    } else if (hue < 127.5) {
+        value = n2;
+    } else if (hue < 170) {
+        value = n1 + (n2 - n1) * ((170 - hue) / 42.5);
+    } else {
+        value = n1;
+    }
+
+    return ROUND(value * 255.0);
+}
+
+static void rgbToHsl(int r, int g, int b, unsigned char *hue, unsigned char *sat, unsigned char *light) {
+    double h, s, l;
+    int min, max;
+    int delta;
+
+    if (r > g) {
+        max = MAX(r, b);
+        min = MIN(g, b);
+    } else {
+        max = MAX(g, b);
+        min = MIN(r, b);
+    }
+
+    l = (max + min) / 2.0;
+
+    if (max == min) {
+        s = 0.0;
+        h = 0.0;
+    } else {
+        delta = (max - min);
+
+        if (l < 128) {
+            s = 255 * (double) delta / (double) (max + min);
+        } else {
+            s = 255 * (double) delta / (double) (511 - max - min);
+        }
+
+        if (r == max) {
+            h = (g - b) / (double) delta;
+        } else if (g == max) {
+            h = 2 + (b - r) / (double) delta;
+        } else {
+            h = 4 + (r - g) / (double) delta;
+        }
+
+        h = h * 42.5;
+        if (h < 0) {
+            h += 255;
+        } else if (h > 255) {
+            h -= 255;
+        }
+    }
+
+    *hue = ROUND(h);
+    *sat = ROUND(s);
+    *light = ROUND(l);
+}
+
+static void hslToRgb(double h, double s, double l,
+                     unsigned char *red, unsigned char *green, unsigned char *blue) {
+    if (s == 0) {
+        /* achromatic case */
+        *red = l;
+        *green = l;
+        *blue = l;
+    } else {
+        double m1, m2;
+
+        if (l < 128)
+            m2 = (l * (255 + s)) / 65025.0;
+        else
+            m2 = (l + s - (l * s) / 255.0) / 255.0;
+
+        m1 = (l / 127.5) - m2;
+
+        /* chromatic case */
+        *red = hslValue(m1, m2, h + 85);
+        *green = hslValue(m1, m2, h);
+        *blue = hslValue(m1, m2, h - 85);
+    }
+}
+
+class BandTask : public QRunnable {
+
+public:
+    BandTask(const ColorizeKernel::LinesFunction *processLines, uchar *bits, int bytesPerLine, int width,
+             int firstLine, int lastLine, QSemaphore *bandsDone) {
+        this->processLines = processLines;
+        this->bits = bits;
+        this->bytesPerLine = bytesPerLine;
+        this->width = width;
+        this->firstLine = firstLine;
+        this->lastLine = lastLine;
+        this->bandsDone = bandsDone;
+    }
+
+    void run() {
+        (*processLines)(bits, bytesPerLine, width, firstLine, lastLine);
+        bandsDone->release();
+    }
+
+private:
+    const ColorizeKernel::LinesFunction *processLines;
+    uchar *bits;
+    int bytesPerLine;
+    int width;
+    int firstLine;
+    int lastLine;
+    QSemaphore *bandsDone;
+};
+
+ColorizeKernel::ColorizeKernel(const ImageProcessor::Parameters &parameters) {
+    unsigned char contrastTransform[256];
+    unsigned char brightTransform[256];
+    int i;
+    float contrast = ((float) parameters.contrastVal / 100.0);
+    float brightness = ((float) parameters.brightVal / 100.0);
+
+    for (i = 0; i < 256; ++i) {
+        if (i < (int) (128.0f + 128.0f * tan(contrast)) && i > (int) (128.0f - 128.0f * tan(contrast))) {
+            contrastTransform[i] = (i - 128) / tan(contrast) + 128;
+        } else if (i >= (int) (128.0f + 128.0f * tan(contrast))) {
+            contrastTransform[i] = 255;
+        } else {
+            contrastTransform[i] = 0;
+        }
+    }
+
+    for (i = 0; i < 256; ++i) {
+        brightTransform[i] = MIN(255, (int) ((255.0 * pow(i / 255.0, 1.0 / brightness)) + 0.5));
+    }
+
+    /* Negation, gain, brightness and contrast only depend on the channel's own value */
+    bool negateEnabled[3] = {parameters.rNegateEnabled, parameters.gNegateEnabled, parameters.bNegateEnabled};
+    int gain[3] = {parameters.redVal, parameters.greenVal, parameters.blueVal};
+    for (int channel = 0; channel < 3; ++channel) {
+        for (i = 0; i < 256; ++i) {
+            int value = negateEnabled[channel] ? 255 - i : i;
+            value = bound0To255((value * (gain[channel] + 100)) / 100);
+            value = brightTransform[value];
+            channelTransform[channel][i] = contrastTransform[value];
+        }
+    }
+
+    for (i = 0; i < 256; ++i) {
+        saturationTransform[i] = bound0To255((i * parameters.saturationVal) / 100);
+        lightnessTransform[i] = bound0To255((i * parameters.lightnessVal) / 100);
+    }
+
+    colorizeEnabled = parameters.colorizeEnabled;
+    hueVal = parameters.hueVal;
+    saturationVal = parameters.saturationVal;
+    lightnessVal = parameters.lightnessVal;
+    hueRedChannel = parameters.hueRedChannel;
+    hueGreenChannel = parameters.hueGreenChannel;
+    hueBlueChannel = parameters.hueBlueChannel;
+
+#ifdef COLORIZE_KERNEL_AVX2
+    vectorEnabled = __builtin_cpu_supports("avx2");
+#else
+    vectorEnabled = false;
+#endif
+}
+
+void ColorizeKernel::setVectorEnabled(bool enabled) {
+#ifdef COLORIZE_KERNEL_AVX2
+    vectorEnabled = enabled && __builtin_cpu_supports("avx2");
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+bool ColorizeKernel::isVectorEnabled() const {
+    return vectorEnabled;
+}
+
+void ColorizeKernel::apply(QImage &image, int threadCount) const {
+    processBands(image, threadCount,
+                 [this](uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) {
+                     processLines(bits, bytesPerLine, width, firstLine, lastLine);
+                 });
+}
+
+void ColorizeKernel::processBands(QImage &image, int threadCount, const LinesFunction &processLines) {
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32) {
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+
+    /* Bands work on the raw scanlines, detach once up front */
+    uchar *bits = image.bits();
+    int bytesPerLine = image.bytesPerLine();
+
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+    int bandCount = qMax(1, qMin(threadCount, image.height() / COLORIZE_MIN_BAND_LINES));
+    int bandLines = (image.height() + bandCount - 1) / bandCount;
+
+    QSemaphore bandsDone;
+    for (int band = 1; band < bandCount; ++band) {
+        int firstLine = band * bandLines;
+        int lastLine = qMin(image.height(), firstLine + bandLines) - 1;
+        bandThreadPool()->start(new BandTask(&processLines, bits, bytesPerLine, image.width(),
+                                             firstLine, lastLine, &bandsDone));
+    }
+
+    /* The calling thread takes the first band itself */
+    processLines(bits, bytesPerLine, image.width(), 0, qMin(image.height(), bandLines) - 1);
+    bandsDone.acquire(bandCount - 1);
+}
+
+void ColorizeKernel::processLines(uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) const {
+    for (int y = firstLine; y <= lastLine; ++y) {
+        QRgb *line = (QRgb *) (bits + (qint64) y * bytesPerLine);
+        int x = 0;
+#ifdef COLORIZE_KERNEL_AVX2
+        if (vectorEnabled) {
+            x = processLineAvx2(line, width);
+        }
+#endif
+        processLineScalar(line + x, width - x);
+    }
+}
+
+void ColorizeKernel::processLineScalar(QRgb *line, int width) const {
+    unsigned char hr, hg, hb;
+    int r, g, b;
+    unsigned char h, s, l;
+
+    for (int x = 0; x < width; ++x) {
+        r = channelTransform[0][qRed(line[x])];
+        g = channelTransform[1][qGreen(line[x])];
+        b = channelTransform[2][qBlue(line[x])];
+
+        rgbToHsl(r, g, b, &h, &s, &l);
+        h = colorizeEnabled ? hueVal : h + hueVal;
+        s = saturationTransform[s];
+        l = lightnessTransform[l];
+        hslToRgb(h, s, l, &hr, &hg, &hb);
+
+        r = hueRedChannel ? hr : qRed(line[x]);
+        g = hueGreenChannel ? hg : qGreen(line[x]);
+        b = hueBlueChannel ? hb : qBlue(line[x]);
+        line[x] = qRgba(r, g, b, qAlpha(line[x]));
+    }
+}
+
+#ifdef COLORIZE_KERNEL_AVX2
+
+/* Eight pixels at a time. RGB to HSL stays in double precision, as in rgbToHsl(), so that the
+   rounding to whole HSL values is the same. HSL to RGB starts from whole values and float is exact. */
+typedef double DoubleVector __attribute__((vector_size(32)));
+typedef long long DoubleMaskVector __attribute__((vector_size(32)));
+typedef int HalfIntVector __attribute__((vector_size(16)));
+typedef float FloatVector __attribute__((vector_size(32)));
+typedef int IntVector __attribute__((vector_size(32)));
+#define VECTOR_WIDTH 8
+
+__attribute__((target("avx2")))
+static inline void rgbToHslVector(DoubleVector r, DoubleVector g, DoubleVector b,
+                                  HalfIntVector &hue, HalfIntVector &saturation, HalfIntVector &lightness) {
+    DoubleVector max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    DoubleVector min = r > g ? (g < b ? g : b) : (r < b ? r : b);
+    DoubleVector sum = max + min;
+    DoubleVector delta = max - min;
+    DoubleVector l = sum / 2.0;
+    DoubleMaskVector gray = max == min;
+    DoubleVector safeDelta = gray ? 1.0 : delta;
+
+    DoubleVector s = 255.0 * delta / (l < 128.0 ? sum : 511.0 - sum);
+    DoubleVector h = r == max ? (g - b) / safeDelta
+                              : (g == max ? 2.0 + (b - r) / safeDelta : 4.0 + (r - g) / safeDelta);
+    h = h * 42.5;
+    h = h < 0.0 ? h + 255.0 : (h > 255.0 ? h - 255.0 : h);
+    h = gray ? 0.0 : h;
+    s = gray ? 0.0 : s;
+
+    hue = __builtin_convertvector(h + 0.5, HalfIntVector);
+    saturation = __builtin_convertvector(s + 0.5, HalfIntVector);
+    lightness = __builtin_convertvector(l + 0.5, HalfIntVector);
+}
+
+__attribute__((target("avx2")))
+static inline IntVector hslValueVector(FloatVector n1, FloatVector n2, FloatVector hue) {
+    hue = hue > 255.0f ? hue - 255.0f : hue;
+    hue = hue < 0.0f ? hue + 255.0f : hue;
+
+    FloatVector rising = n1 + (n2 - n1) * (hue / 42.5f);
+    FloatVector falling = n1 + (n2 - n1) * ((170.0f - hue) / 42.5f);
+    FloatVector value = hue < 42.5f ? rising : (hue < 127.5f ? n2 : (hue < 170.0f ? falling : n1));
+    return __builtin_convertvector(value * 255.0f + 0.5f, IntVector);
+}
+
+int ColorizeKernel::processLineAvx2(QRgb *line, int width) const {
+    int x;
+
+    for (x = 0; x + VECTOR_WIDTH <= width; x += VECTOR_WIDTH) {
+        DoubleVector r[2], g[2], b[2];
+        for (int i = 0; i < VECTOR_WIDTH; ++i) {
+            r[i / 4][i % 4] = channelTransform[0][qRed(line[x + i])];
+            g[i / 4][i % 4] = channelTransform[1][qGreen(line[x + i])];
+            b[i / 4][i % 4] = channelTransform[2][qBlue(line[x + i])];
+        }
+
+        HalfIntVector hueHalf[2], saturationHalf[2], lightnessHalf[2];
+        rgbToHslVector(r[0], g[0], b[0], hueHalf[0], saturationHalf[0], lightnessHalf[0]);
+        rgbToHslVector(r[1], g[1], b[1], hueHalf[1], saturationHalf[1], lightnessHalf[1]);
+
+        IntVector hue, saturation, lightness;
+        for (int i = 0; i < VECTOR_WIDTH; ++i) {
+            hue[i] = hueHalf[i / 4][i % 4];
+            saturation[i] = saturationHalf[i / 4][i % 4];
+            lightness[i] = lightnessHalf[i / 4][i % 4];
+        }
+
+        /* Same as the unsigned char arithmetic of the scalar path */
+        hue = colorizeEnabled ? (IntVector) {} + (hueVal & 255) : (hue + hueVal) & 255;
+        saturation = saturation * saturationVal / 100;
+        saturation = saturation > 255 ? 255 : (saturation < 0 ? 0 : saturation);
+        lightness = lightness * lightnessVal / 100;
+        lightness = lightness > 255 ? 255 : (lightness < 0 ? 0 : lightness);
+
+        FloatVector h = __builtin_convertvector(hue, FloatVector);
+        FloatVector s = __builtin_convertvector(saturation, FloatVector);
+        FloatVector l = __builtin_convertvector(lightness, FloatVector);
+        FloatVector m2 = l < 128.0f ? (l * (255.0f + s)) / 65025.0f : (l + s - (l * s) / 255.0f) / 255.0f;
+        FloatVector m1 = l / 127.5f - m2;
+
+        IntVector achromatic = s == 0.0f;
+        IntVector hr = achromatic ? lightness : hslValueVector(m1, m2, h + 85.0f);
+        IntVector hg = achromatic ? lightness : hslValueVector(m1, m2, h);
+        IntVector hb = achromatic ? lightness : hslValueVector(m1, m2, h - 85.0f);
+
+        for (int i = 0; i < VECTOR_WIDTH; ++i) {
+            QRgb pixel = line[x + i];
+            line[x + i] = qRgba(hueRedChannel ? (unsigned char) hr[i] : qRed(pixel),
+                                hueGreenChannel ? (unsigned char) hg[i] : qGreen(pixel),
+                                hueBlueChannel ? (unsigned char) hb[i] : qBlue(pixel),
+                                qAlpha(pixel));
+        }
+    }
+
+    return x;
+}
+
+#endif // COLORIZE_KERNEL_AVX2
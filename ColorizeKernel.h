@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COLORIZE_KERNEL_H
+#define COLORIZE_KERNEL_H
+
+#include <functional>
+#include <QImage>
+#include "ImageProcessor.h"
+
+#define COLORIZE_MIN_BAND_LINES 64
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLORIZE_KERNEL_AVX2
+#endif
+
+/*
+ * The viewer's color adjustments: channel negation and gains, brightness, contrast, hue,
+ * saturation and lightness. The per channel steps are folded into lookup tables, the HSL
+ * round trip runs on AVX2 vectors when the CPU has them and the image is split into bands
+ * of scanlines processed in parallel. Both paths give the same result as the original
+ * double precision code.
+ */
+class ColorizeKernel {
+
+public:
+    ColorizeKernel(const ImageProcessor::Parameters &parameters);
+
+    /* A threadCount of 0 uses every core */
+    void apply(QImage &image, int threadCount = 0) const;
+
+    void processLines(uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine) const;
+
+    typedef std::function<void(uchar *bits, int bytesPerLine, int width, int firstLine, int lastLine)> LinesFunction;
+
+    /* Converts image to 32 bit RGB and runs processLines on bands of its scanlines in parallel,
+       on a thread pool shared by every caller. A threadCount of 0 uses every core. */
+    static void processBands(QImage &image, int threadCount, const LinesFunction &processLines);
+
+    /* Vector code is used when the CPU supports it, unless disabled here */
+    void setVectorEnabled(bool enabled);
+
+    bool isVectorEnabled() const;
+
+private:
+    unsigned char channelTransform[3][256];
+    unsigned char saturationTransform[256];
+    unsigned char lightnessTransform[256];
+    bool colorizeEnabled;
+    int hueVal;
+    int saturationVal;
+    int lightnessVal;
+    bool hueRedChannel;
+    bool hueGreenChannel;
+    bool hueBlueChannel;
+    bool vectorEnabled;
+
+    void processLineScalar(QRgb *line, int width) const;
+
+#ifdef COLORIZE_KERNEL_AVX2
+    __attribute__((target("avx2"))) int processLineAvx2(QRgb *line, int width) const;
+#endif
+};
+
+#endif // COLORIZE_KERNEL_H
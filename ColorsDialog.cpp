@@ -51,7 +51,6 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     hueSlider->setTickPosition(QSlider::TicksAbove);
     hueSlider->setTickInterval(25);
     hueSlider->setRange(-100, 100);
-    hueSlider->setTracking(false);
     connect(hueSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     colorizeCheckBox = new QCheckBox(tr("Colorize"), this);
@@ -74,14 +73,12 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     saturationSlider->setTickPosition(QSlider::TicksAbove);
     saturationSlider->setTickInterval(25);
     saturationSlider->setRange(-100, 100);
-    saturationSlider->setTracking(false);
     connect(saturationSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     lightnessSlider = new QSlider(Qt::Horizontal);
     lightnessSlider->setTickPosition(QSlider::TicksAbove);
     lightnessSlider->setTickInterval(25);
     lightnessSlider->setRange(-100, 100);
-    lightnessSlider->setTracking(false);
     connect(lightnessSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     QHBoxLayout *channelsHbox = new QHBoxLayout;
@@ -129,14 +126,12 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     brightSlider->setTickPosition(QSlider::TicksAbove);
     brightSlider->setTickInterval(25);
     brightSlider->setRange(-100, 100);
-    brightSlider->setTracking(false);
     connect(brightSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     contrastSlider = new QSlider(Qt::Horizontal);
     contrastSlider->setTickPosition(QSlider::TicksAbove);
     contrastSlider->setTickInterval(25);
     contrastSlider->setRange(-100, 100);
-    contrastSlider->setTracking(false);
     contrastSlider->setInvertedAppearance(true);
     connect(contrastSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
@@ -156,7 +151,6 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     redSlider->setTickPosition(QSlider::TicksAbove);
     redSlider->setTickInterval(25);
     redSlider->setRange(-100, 100);
-    redSlider->setTracking(false);
     connect(redSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     QLabel *greenLab = new QLabel(tr("Green"));
@@ -164,7 +158,6 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     greenSlider->setTickPosition(QSlider::TicksAbove);
     greenSlider->setTickInterval(25);
     greenSlider->setRange(-100, 100);
-    greenSlider->setTracking(false);
     connect(greenSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     QLabel *blueLab = new QLabel(tr("Blue"));
@@ -172,7 +165,6 @@ ColorsDialog::ColorsDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(
     blueSlider->setTickPosition(QSlider::TicksAbove);
     blueSlider->setTickInterval(25);
     blueSlider->setRange(-100, 100);
-    blueSlider->setTracking(false);
     connect(blueSlider, SIGNAL(valueChanged(int)), this, SLOT(applyColors(int)));
 
     QGridLayout *channelMixbox = new QGridLayout;
@@ -233,7 +225,7 @@ void ColorsDialog::applyColors(int) {
     Settings::greenVal = greenSlider->value();
     Settings::blueVal = blueSlider->value();
 
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::ok() {
@@ -264,40 +256,40 @@ void ColorsDialog::reset() {
     greenSlider->setValue(0);
     blueSlider->setValue(0);
 
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::enableColorize(int state) {
     Settings::colorizeEnabled = state;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::redNegative(int state) {
     Settings::rNegateEnabled = state;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::greenNegative(int state) {
     Settings::gNegateEnabled = state;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::blueNegative(int state) {
     Settings::bNegateEnabled = state;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::setRedChannel() {
     Settings::hueRedChannel = redCheckBox->isChecked();
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::setGreenChannel() {
     Settings::hueGreenChannel = greenCheckBox->isChecked();
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void ColorsDialog::setBlueChannel() {
     Settings::hueBlueChannel = blueCheckBox->isChecked();
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
@@ -0,0 +1,286 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QSet>
+#include "CommandLine.h"
+#include "ThumbnailCache.h"
+#include "MetadataCache.h"
+#include "MetadataIndex.h"
+#include "BatchProcessor.h"
+
+static const char *const imageSuffixes[] = {
+        "bmp", "cur", "dds", "gif", "icns", "ico", "jpeg", "jpg", "jp2", "jpe", "mng", "pbm", "pgm", "png",
+        "ppm", "svg", "svgz", "tga", "tif", "tiff", "wbmp", "webp", "xbm", "xpm"
+};
+
+CommandLine::CommandLine() {
+    batchJob = nullptr;
+}
+
+bool CommandLine::isCommand(const QString &argument) {
+    return argument == "prewarm" || argument == "index" || argument == "convert";
+}
+
+void CommandLine::showHelp() {
+    qInfo() << "Usage: phototonic COMMAND [OPTION]... FILE|DIRECTORY...";
+    qInfo() << "  prewarm\t\t\tcreate the shared thumbnails of all images";
+    qInfo() << "  index\t\t\t\tstore orientation and keywords of all images in the metadata index";
+    qInfo() << "  convert\t\t\tsave all images in another format or size";
+    qInfo() << "  -j, --threads=N\t\tnumber of worker threads";
+    qInfo() << "  --size=128|256\t\tprewarm: thumbnail size (default 128)";
+    qInfo() << "  --format=FORMAT\t\tconvert: output format, the source format by default";
+    qInfo() << "  --quality=0-100\t\tconvert: output quality (default 90)";
+    qInfo() << "  --scale=PERCENT\t\tconvert: scale by a percentage";
+    qInfo() << "  --fit=WxH\t\t\tconvert: scale larger images down to fit";
+    qInfo() << "  --output=DIRECTORY\t\tconvert: save into a directory instead of next to the source";
+    qInfo() << "  --overwrite\t\t\tconvert: replace existing files";
+}
+
+int CommandLine::run(const QStringList &arguments) {
+    command = arguments.at(1);
+
+    QCommandLineParser parser;
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads", "", "N", "0");
+    QCommandLineOption sizeOption("size", "", "SIZE", QString::number(THUMBNAIL_CACHE_NORMAL_SIZE));
+    QCommandLineOption formatOption("format", "", "FORMAT");
+    QCommandLineOption qualityOption("quality", "", "QUALITY", "90");
+    QCommandLineOption scaleOption("scale", "", "PERCENT");
+    QCommandLineOption fitOption("fit", "", "WxH");
+    QCommandLineOption outputOption("output", "", "DIRECTORY");
+    QCommandLineOption overwriteOption("overwrite");
+    parser.addOptions(QList<QCommandLineOption>() << threadsOption << sizeOption << formatOption << qualityOption
+                                                  << scaleOption << fitOption << outputOption << overwriteOption);
+
+    /* The command itself is not an argument of the parser */
+    QStringList parserArguments = arguments;
+    parserArguments.removeAt(1);
+    if (!parser.parse(parserArguments)) {
+        qCritical().noquote() << parser.errorText();
+        return ExitUsage;
+    }
+
+    if (parser.positionalArguments().isEmpty()) {
+        showHelp();
+        return ExitUsage;
+    }
+
+    bool ok;
+    int threads = parser.value(threadsOption).toInt(&ok);
+    if (!ok || threads < 0) {
+        qCritical() << "Invalid thread count";
+        return ExitUsage;
+    }
+
+    QStringList fileList = collectImages(parser.positionalArguments());
+    BatchJob::Task task;
+    MetadataIndex metadataIndex;
+
+    if (command == "prewarm") {
+        int cacheSize = parser.value(sizeOption).toInt();
+        if (cacheSize != THUMBNAIL_CACHE_NORMAL_SIZE && cacheSize != THUMBNAIL_CACHE_LARGE_SIZE) {
+            qCritical() << "Invalid thumbnail size";
+            return ExitUsage;
+        }
+
+        task = [cacheSize](const QString &fileName, QString &errorString) -> bool {
+            QImage thumbnail;
+            return ThumbnailCache::load(fileName, cacheSize, thumbnail)
+                   || ThumbnailCache::create(fileName, cacheSize, thumbnail, errorString);
+        };
+
+    } else if (command == "index") {
+        metadataIndex.load();
+        MetadataIndex *index = &metadataIndex;
+
+        task = [index](const QString &fileName, QString &errorString) -> bool {
+            QSet<QString> tags;
+            long orientation = 0;
+            if (index->find(fileName, orientation, tags)) {
+                return true;
+            }
+
+            /* Images without metadata are indexed as such, only files that cannot be read fail */
+            if (!MetadataCache::readImageMetadata(fileName, orientation, tags)) {
+                QImageReader imageReader(fileName);
+                if (!imageReader.canRead()) {
+                    errorString = imageReader.errorString();
+                    return false;
+                }
+                orientation = 0;
+                tags.clear();
+            }
+
+            index->insert(fileName, orientation, tags);
+            return true;
+        };
+
+    } else {
+        BatchProcessor::Options options;
+        options.parameters = ImageProcessor::Parameters();
+        options.applyExifOrientation = true;
+        options.scaleMode = BatchProcessor::ScaleNone;
+        options.scalePercent = 100;
+        options.format = parser.value(formatOption).toLatin1().toLower();
+        options.quality = parser.value(qualityOption).toInt(&ok);
+        if (!ok || options.quality < 0 || options.quality > 100) {
+            qCritical() << "Invalid quality";
+            return ExitUsage;
+        }
+
+        if (parser.isSet(scaleOption)) {
+            options.scaleMode = BatchProcessor::ScalePercent;
+            options.scalePercent = parser.value(scaleOption).toInt(&ok);
+            if (!ok || options.scalePercent <= 0) {
+                qCritical() << "Invalid scale";
+                return ExitUsage;
+            }
+        } else if (parser.isSet(fitOption)) {
+            QStringList fitSize = parser.value(fitOption).split('x');
+            int width = 0, height = 0;
+            if (fitSize.size() == 2) {
+                width = fitSize.at(0).toInt();
+                height = fitSize.at(1).toInt();
+            }
+            if (width <= 0 || height <= 0) {
+                qCritical() << "Invalid fit size";
+                return ExitUsage;
+            }
+            options.scaleMode = BatchProcessor::ScaleFit;
+            options.fitSize = QSize(width, height);
+        }
+
+        options.outputDirectory = parser.value(outputOption);
+        if (!options.outputDirectory.isEmpty() && !QFileInfo(options.outputDirectory).isDir()) {
+            qCritical() << "The output directory does not exist";
+            return ExitUsage;
+        }
+        options.overwrite = parser.isSet(overwriteOption);
+
+        QStringList conflictingOutputs = BatchProcessor::getConflictingOutputs(fileList, options);
+        if (!conflictingOutputs.isEmpty()) {
+            qCritical().noquote() << "Output file shared by several images or replacing another one:"
+                                   << conflictingOutputs.first();
+            return ExitUsage;
+        }
+
+        task = [options](const QString &fileName, QString &errorString) -> bool {
+            return BatchProcessor::processImage(fileName, options, errorString);
+        };
+    }
+
+    QJsonObject startEvent;
+    startEvent["event"] = "start";
+    startEvent["command"] = command;
+    startEvent["total"] = fileList.size();
+    writeEvent(startEvent);
+
+    elapsedTimer.start();
+    QEventLoop eventLoop;
+    batchJob = new BatchJob(this, fileList, task, threads);
+    connect(batchJob, SIGNAL(fileDone(QString, bool, QString)), this, SLOT(onFileDone(QString, bool, QString)));
+    connect(batchJob, SIGNAL(finished()), &eventLoop, SLOT(quit()));
+    batchJob->start();
+    if (batchJob->isRunning()) {
+        eventLoop.exec();
+    }
+
+    int failedCount = batchJob->getFailedFiles().size();
+    bool saved = true;
+    if (command == "index") {
+        QSet<QString> indexedFiles = fileList.toSet();
+        for (const QString &path : parser.positionalArguments()) {
+            QFileInfo pathInfo(path);
+            if (pathInfo.isDir()) {
+                metadataIndex.prune(pathInfo.absoluteFilePath(), indexedFiles);
+            }
+        }
+        saved = metadataIndex.save();
+    }
+
+    QJsonObject finishedEvent;
+    finishedEvent["event"] = "finished";
+    finishedEvent["command"] = command;
+    finishedEvent["total"] = fileList.size();
+    finishedEvent["succeeded"] = batchJob->getSucceededFiles().size();
+    finishedEvent["failed"] = failedCount;
+    finishedEvent["elapsedMs"] = (double) elapsedTimer.elapsed();
+    if (!saved) {
+        finishedEvent["error"] = QString("Failed to save " + MetadataIndex::getIndexPath());
+    }
+    writeEvent(finishedEvent);
+
+    delete batchJob;
+    batchJob = nullptr;
+
+    return (failedCount || !saved) ? ExitFailed : ExitOk;
+}
+
+void CommandLine::onFileDone(QString fileName, bool success, QString errorString) {
+    QJsonObject fileEvent;
+    fileEvent["event"] = "file";
+    fileEvent["file"] = fileName;
+    fileEvent["status"] = success ? "ok" : "failed";
+    if (!success) {
+        fileEvent["error"] = errorString;
+    }
+    fileEvent["done"] = batchJob->getSucceededFiles().size() + batchJob->getFailedFiles().size();
+    fileEvent["total"] = batchJob->getFileList().size();
+    writeEvent(fileEvent);
+}
+
+/* Absolute paths of the given images and of all images below the given directories */
+QStringList CommandLine::collectImages(const QStringList &paths) {
+    QStringList nameFilters;
+    for (const char *suffix : imageSuffixes) {
+        nameFilters << QString("*.") + suffix;
+    }
+
+    QStringList fileList;
+    for (const QString &path : paths) {
+        QFileInfo pathInfo(path);
+        if (pathInfo.isDir()) {
+            QDirIterator dirIterator(pathInfo.absoluteFilePath(), nameFilters, QDir::Files,
+                                     QDirIterator::Subdirectories);
+            while (dirIterator.hasNext()) {
+                fileList.append(dirIterator.next());
+            }
+        } else if (pathInfo.isFile()) {
+            fileList.append(pathInfo.absoluteFilePath());
+        } else {
+            qWarning().noquote() << "No such file or directory:" << path;
+        }
+    }
+
+    fileList.removeDuplicates();
+    return fileList;
+}
+
+void CommandLine::writeEvent(const QJsonObject &event) {
+    QByteArray line = QJsonDocument(event).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    fwrite(line.constData(), 1, line.size(), stdout);
+    fflush(stdout);
+}
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QStringList>
+#include "BatchJob.h"
+
+/*
+ * Runs without a window: "phototonic prewarm|index|convert [OPTION]... PATH..."
+ * walks the given files and directories and processes every image on a pool of
+ * worker threads. Progress is written to stdout as one JSON object per line.
+ */
+class CommandLine : public QObject {
+Q_OBJECT
+
+public:
+    enum ExitCodes {
+        ExitOk = 0,
+        ExitFailed,
+        ExitUsage
+    };
+
+    CommandLine();
+
+    static bool isCommand(const QString &argument);
+
+    static void showHelp();
+
+    int run(const QStringList &arguments);
+
+private slots:
+
+    void onFileDone(QString fileName, bool success, QString errorString);
+
+private:
+    QString command;
+    QElapsedTimer elapsedTimer;
+    BatchJob *batchJob;
+
+    static QStringList collectImages(const QStringList &paths);
+
+    static void writeEvent(const QJsonObject &event);
+};
+
+#endif // COMMAND_LINE_H
@@ -17,6 +17,7 @@
  */
 
 #include "CopyMoveDialog.h"
+#include "XmpSidecar.h"
 
 static QString autoRename(QString &destDir, QString &currFile) {
     int extSep = currFile.lastIndexOf(".");
@@ -54,6 +55,14 @@ int CopyMoveDialog::copyOrMoveFile(bool isCopy, QString &srcFile, QString &srcPa
         dstPath = newDestPath;
     }
 
+    if (res) {
+        if (isCopy) {
+            XmpSidecar::copy(srcPath, dstPath);
+        } else {
+            XmpSidecar::rename(srcPath, dstPath);
+        }
+    }
+
     return res;
 }
 
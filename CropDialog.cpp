@@ -39,22 +39,18 @@ CropDialog::CropDialog(QWidget *parent, ImageViewer *imageViewer) : QDialog(pare
     QSlider *topSlide = new QSlider(Qt::Horizontal);
     topSlide->setTickPosition(QSlider::TicksAbove);
     topSlide->setTickInterval(10);
-    topSlide->setTracking(false);
 
     QSlider *bottomSlide = new QSlider(Qt::Horizontal);
     bottomSlide->setTickPosition(QSlider::TicksAbove);
     bottomSlide->setTickInterval(10);
-    bottomSlide->setTracking(false);
 
     QSlider *leftSlide = new QSlider(Qt::Horizontal);
     leftSlide->setTickPosition(QSlider::TicksAbove);
     leftSlide->setTickInterval(10);
-    leftSlide->setTracking(false);
 
     QSlider *rightSlide = new QSlider(Qt::Horizontal);
     rightSlide->setTickPosition(QSlider::TicksAbove);
     rightSlide->setTickInterval(10);
-    rightSlide->setTracking(false);
 
     topSpinBox = new QSpinBox;
     topSpinBox->setPrefix("% ");
@@ -122,7 +118,7 @@ void CropDialog::applyCrop(int) {
     Settings::cropTopPercent = topSpinBox->value();
     Settings::cropWidthPercent = rightSpinBox->value();
     Settings::cropHeightPercent = bottomSpinBox->value();
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
 }
 
 void CropDialog::ok() {
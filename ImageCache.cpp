@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QImageReader>
+#include "ImageCache.h"
+
+ImageCache::Entry::Entry(ImageCache *imageCache, const QString &fileKey, const QSize &size, const QImage &image) {
+    this->imageCache = imageCache;
+    this->fileKey = fileKey;
+    this->size = size;
+    this->image = image;
+}
+
+/* Runs inside cache operations, with the mutex already held */
+ImageCache::Entry::~Entry() {
+    QHash<QString, QList<QSize> >::iterator sizes = imageCache->variantSizes.find(fileKey);
+    if (sizes == imageCache->variantSizes.end()) {
+        return;
+    }
+
+    sizes->removeAll(size);
+    if (sizes->isEmpty()) {
+        imageCache->variantSizes.erase(sizes);
+    }
+}
+
+ImageCache::ImageCache() {
+    /* Costs are in KB */
+    cache.setMaxCost(IMAGE_CACHE_BUDGET_MB * 1024);
+}
+
+/* The entries reach back into variantSizes when they are deleted */
+ImageCache::~ImageCache() {
+    clear();
+}
+
+QString ImageCache::fileKey(const QString &imageFileName) {
+    QFileInfo imageFileInfo(imageFileName);
+    return imageFileInfo.absoluteFilePath()
+           + "|" + QString::number(imageFileInfo.lastModified().toMSecsSinceEpoch())
+           + "|" + QString::number(imageFileInfo.size());
+}
+
+QString ImageCache::variantKey(const QString &fileKey, const QSize &size) {
+    if (!size.isValid()) {
+        return fileKey + "|full";
+    }
+
+    return fileKey + "|" + QString::number(size.width()) + "x" + QString::number(size.height());
+}
+
+void ImageCache::insertVariant(const QString &fileKey, const QImage &image, bool fullResolution) {
+    if (image.isNull()) {
+        return;
+    }
+
+    QSize size = fullResolution ? QSize() : image.size();
+    int cost = qMax(1, (int) ((qint64) image.bytesPerLine() * image.height() / 1024));
+    if (!cache.insert(variantKey(fileKey, size), new Entry(this, fileKey, size, image), cost)) {
+        return;
+    }
+
+    QList<QSize> &sizes = variantSizes[fileKey];
+    if (!sizes.contains(size)) {
+        sizes.append(size);
+    }
+}
+
+bool ImageCache::find(const QString &imageFileName, QImage &image) {
+    QString key = variantKey(fileKey(imageFileName), QSize());
+
+    QMutexLocker locker(&mutex);
+    Entry *cachedEntry = cache.object(key);
+    if (!cachedEntry) {
+        return false;
+    }
+
+    image = cachedEntry->image;
+    return true;
+}
+
+void ImageCache::insert(const QString &imageFileName, const QImage &image) {
+    QString key = fileKey(imageFileName);
+
+    QMutexLocker locker(&mutex);
+    insertVariant(key, image, true);
+}
+
+QImage ImageCache::loadScaled(const QString &imageFileName, const QSize &boundingSize) {
+    QString key = fileKey(imageFileName);
+    QImage sourceImage;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        /* Use the smallest cached variant that still covers the requested size */
+        QList<QSize> sizes = variantSizes.value(key);
+        QImage *bestImage = nullptr;
+        for (int i = 0; i < sizes.size(); ++i) {
+            Entry *cachedEntry = cache.object(variantKey(key, sizes.at(i)));
+            if (!cachedEntry) {
+                continue;
+            }
+
+            QImage *cachedImage = &cachedEntry->image;
+
+            bool fullResolution = !sizes.at(i).isValid();
+            if (!fullResolution && cachedImage->width() < boundingSize.width()
+                && cachedImage->height() < boundingSize.height()) {
+                continue;
+            }
+
+            if (!bestImage || cachedImage->width() < bestImage->width()) {
+                bestImage = cachedImage;
+            }
+        }
+
+        if (bestImage) {
+            if (bestImage->width() <= boundingSize.width() && bestImage->height() <= boundingSize.height()) {
+                return *bestImage;
+            }
+            sourceImage = *bestImage;
+        }
+    }
+
+    QImage scaledImage;
+    if (!sourceImage.isNull()) {
+        scaledImage = sourceImage.scaled(boundingSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    } else {
+        /* Nothing cached, let the reader decode straight to the smaller size where the format supports it */
+        QImageReader imageReader(imageFileName);
+        QSize imageSize = imageReader.size();
+        if (!imageSize.isValid()) {
+            return QImage();
+        }
+
+        bool downscale = imageSize.width() > boundingSize.width() || imageSize.height() > boundingSize.height();
+        if (downscale) {
+            imageReader.setScaledSize(imageSize.scaled(boundingSize, Qt::KeepAspectRatio));
+        }
+
+        if (!imageReader.read(&scaledImage)) {
+            return QImage();
+        }
+
+        if (!downscale) {
+            QMutexLocker locker(&mutex);
+            insertVariant(key, scaledImage, true);
+            return scaledImage;
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+    insertVariant(key, scaledImage, false);
+    return scaledImage;
+}
+
+void ImageCache::remove(const QString &imageFileName) {
+    QString key = fileKey(imageFileName);
+
+    QMutexLocker locker(&mutex);
+    QList<QSize> sizes = variantSizes.value(key);
+    for (int i = 0; i < sizes.size(); ++i) {
+        cache.remove(variantKey(key, sizes.at(i)));
+    }
+}
+
+void ImageCache::clear() {
+    QMutexLocker locker(&mutex);
+    cache.clear();
+}
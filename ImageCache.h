@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QImage>
+#include <QString>
+#include <QSize>
+
+#define IMAGE_CACHE_BUDGET_MB 512
+
+/*
+ * Least recently used cache of decoded images, limited by their memory size.
+ * Entries are keyed by path, modification time and file size, so a file changed
+ * on disk is never served from the cache. Besides the full resolution decode,
+ * downscaled variants (previews, icons) of the same file are kept.
+ * Images are stored as implicitly shared QImages and may be used from any thread.
+ */
+class ImageCache {
+
+public:
+    ImageCache();
+
+    ~ImageCache();
+
+    bool find(const QString &imageFileName, QImage &image);
+
+    void insert(const QString &imageFileName, const QImage &image);
+
+    /* Returns the image scaled to fit boundingSize, from the cache if possible */
+    QImage loadScaled(const QString &imageFileName, const QSize &boundingSize);
+
+    void remove(const QString &imageFileName);
+
+    void clear();
+
+private:
+    /* Drops its size from variantSizes when QCache deletes it, evicted or removed */
+    struct Entry {
+        Entry(ImageCache *imageCache, const QString &fileKey, const QSize &size, const QImage &image);
+
+        ~Entry();
+
+        ImageCache *imageCache;
+        QString fileKey;
+        QSize size;
+        QImage image;
+    };
+
+    QMutex mutex;
+
+    /* Sizes of the variants cached per file key, declared before the cache whose entries update it */
+    QHash<QString, QList<QSize> > variantSizes;
+
+    QCache<QString, Entry> cache;
+
+    static QString fileKey(const QString &imageFileName);
+
+    static QString variantKey(const QString &fileKey, const QSize &size);
+
+    void insertVariant(const QString &fileKey, const QImage &image, bool fullResolution);
+};
+
+#endif // IMAGE_CACHE_H
@@ -0,0 +1,315 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <QFile>
+#include <QBuffer>
+#include <QtEndian>
+#include "ImageHeaderParser.h"
+
+#define TIFF_TAG_ORIENTATION 0x0112
+#define TIFF_TAG_IPTC 0x83BB
+#define TIFF_TAG_PHOTOSHOP 0x8649
+#define TIFF_MAX_IFD_ENTRIES 1024
+#define PHOTOSHOP_IPTC_RESOURCE 0x0404
+#define IPTC_MAX_SIZE (16 * 1024 * 1024)
+
+static const char exifHeader[] = "Exif\0\0";
+static const char photoshopHeader[] = "Photoshop 3.0\0";
+
+static inline quint16 readUInt16(const uchar *data, bool bigEndian) {
+    return bigEndian ? qFromBigEndian<quint16>(data) : qFromLittleEndian<quint16>(data);
+}
+
+static inline quint32 readUInt32(const uchar *data, bool bigEndian) {
+    return bigEndian ? qFromBigEndian<quint32>(data) : qFromLittleEndian<quint32>(data);
+}
+
+static int tiffTypeSize(quint16 type) {
+    switch (type) {
+        case 1: // BYTE
+        case 2: // ASCII
+        case 6: // SBYTE
+        case 7: // UNDEFINED
+            return 1;
+        case 3: // SHORT
+        case 8: // SSHORT
+            return 2;
+        case 4: // LONG
+        case 9: // SLONG
+        case 11: // FLOAT
+        case 13: // IFD
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+bool ImageHeaderParser::readMetadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags) {
+    QFile imageFile(imageFullPath);
+    if (!imageFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray magic = imageFile.peek(4);
+    if (magic.size() < 4) {
+        return false;
+    }
+
+    if ((uchar) magic[0] == 0xFF && (uchar) magic[1] == 0xD8) {
+        return parseJpeg(imageFile, orientation, tags);
+    }
+
+    if (magic == QByteArray("II*\0", 4) || magic == QByteArray("MM\0*", 4)) {
+        return parseTiff(imageFile, orientation, &tags);
+    }
+
+    return false;
+}
+
+bool ImageHeaderParser::parseJpeg(QIODevice &device, long &orientation, QSet<QString> &tags) {
+    QByteArray photoshopResources;
+    bool exifFound = false;
+    uchar byte;
+
+    if (!device.seek(2)) {
+        return false;
+    }
+
+    for (;;) {
+        /* Markers may be preceded by any number of fill bytes */
+        if (!device.getChar((char *) &byte)) {
+            return false;
+        }
+        if (byte != 0xFF) {
+            return false;
+        }
+        do {
+            if (!device.getChar((char *) &byte)) {
+                return false;
+            }
+        } while (byte == 0xFF);
+
+        /* Start of scan or end of image, no more metadata segments to expect */
+        if (byte == 0xDA || byte == 0xD9) {
+            break;
+        }
+
+        /* Stand alone markers without a length field */
+        if ((byte >= 0xD0 && byte <= 0xD7) || byte == 0x01) {
+            continue;
+        }
+
+        uchar lengthBytes[2];
+        if (device.read((char *) lengthBytes, 2) != 2) {
+            return false;
+        }
+        qint64 segmentLength = qFromBigEndian<quint16>(lengthBytes) - 2;
+        if (segmentLength < 0) {
+            return false;
+        }
+
+        if (byte == 0xE1 && !exifFound) {
+            QByteArray segment = device.read(segmentLength);
+            if (segment.size() != segmentLength) {
+                return false;
+            }
+
+            if (segment.startsWith(QByteArray(exifHeader, 6))) {
+                QBuffer exifBuffer;
+                exifBuffer.setData(segment.mid(6));
+                exifBuffer.open(QIODevice::ReadOnly);
+                if (!parseTiff(exifBuffer, orientation, 0)) {
+                    return false;
+                }
+                exifFound = true;
+            }
+        } else if (byte == 0xED) {
+            QByteArray segment = device.read(segmentLength);
+            if (segment.size() != segmentLength) {
+                return false;
+            }
+
+            if (segment.startsWith(QByteArray(photoshopHeader, 14))) {
+                photoshopResources.append(segment.mid(14));
+            }
+        } else if (!device.seek(device.pos() + segmentLength)) {
+            return false;
+        }
+    }
+
+    if (!photoshopResources.isEmpty()) {
+        parsePhotoshopResources(photoshopResources, tags);
+    }
+
+    return true;
+}
+
+bool ImageHeaderParser::parseTiff(QIODevice &device, long &orientation, QSet<QString> *tags) {
+    uchar header[8];
+    if (!device.seek(0) || device.read((char *) header, 8) != 8) {
+        return false;
+    }
+
+    bool bigEndian;
+    if (header[0] == 'I' && header[1] == 'I') {
+        bigEndian = false;
+    } else if (header[0] == 'M' && header[1] == 'M') {
+        bigEndian = true;
+    } else {
+        return false;
+    }
+
+    /* BigTIFF and anything else unusual is left to Exiv2 */
+    if (readUInt16(header + 2, bigEndian) != 42) {
+        return false;
+    }
+
+    quint32 ifdOffset = readUInt32(header + 4, bigEndian);
+    uchar countBytes[2];
+    if (!device.seek(ifdOffset) || device.read((char *) countBytes, 2) != 2) {
+        return false;
+    }
+
+    int entriesCount = readUInt16(countBytes, bigEndian);
+    if (entriesCount > TIFF_MAX_IFD_ENTRIES) {
+        return false;
+    }
+
+    QByteArray entries = device.read(entriesCount * 12);
+    if (entries.size() != entriesCount * 12) {
+        return false;
+    }
+
+    for (int i = 0; i < entriesCount; ++i) {
+        const uchar *entry = (const uchar *) entries.constData() + i * 12;
+        quint16 tag = readUInt16(entry, bigEndian);
+        quint16 type = readUInt16(entry + 2, bigEndian);
+        quint32 count = readUInt32(entry + 4, bigEndian);
+
+        if (tag == TIFF_TAG_ORIENTATION) {
+            if (type == 3) {
+                orientation = readUInt16(entry + 8, bigEndian);
+            } else if (type == 4) {
+                orientation = readUInt32(entry + 8, bigEndian);
+            }
+        } else if (tags && (tag == TIFF_TAG_IPTC || tag == TIFF_TAG_PHOTOSHOP)) {
+            qint64 dataSize = (qint64) count * tiffTypeSize(type);
+            if (dataSize <= 0 || dataSize > IPTC_MAX_SIZE) {
+                continue;
+            }
+
+            QByteArray data;
+            if (dataSize <= 4) {
+                data = QByteArray((const char *) entry + 8, dataSize);
+            } else {
+                if (!device.seek(readUInt32(entry + 8, bigEndian))) {
+                    return false;
+                }
+                data = device.read(dataSize);
+                if (data.size() != dataSize) {
+                    return false;
+                }
+            }
+
+            if (tag == TIFF_TAG_IPTC) {
+                parseIptc(data, *tags);
+            } else {
+                parsePhotoshopResources(data, *tags);
+            }
+        }
+    }
+
+    return true;
+}
+
+void ImageHeaderParser::parsePhotoshopResources(const QByteArray &resources, QSet<QString> &tags) {
+    const uchar *data = (const uchar *) resources.constData();
+    qint64 size = resources.size();
+    qint64 pos = 0;
+
+    while (pos + 12 <= size) {
+        if (memcmp(data + pos, "8BIM", 4) != 0) {
+            break;
+        }
+
+        quint16 resourceId = qFromBigEndian<quint16>(data + pos + 4);
+        pos += 6;
+
+        /* Pascal string name, padded to an even size including the length byte */
+        pos += (data[pos] + 2) & ~1;
+        if (pos + 4 > size) {
+            break;
+        }
+
+        qint64 resourceSize = qFromBigEndian<quint32>(data + pos);
+        pos += 4;
+        if (resourceSize > size - pos) {
+            break;
+        }
+
+        if (resourceId == PHOTOSHOP_IPTC_RESOURCE) {
+            parseIptc(resources.mid(pos, resourceSize), tags);
+        }
+
+        pos += (resourceSize + 1) & ~1;
+    }
+}
+
+void ImageHeaderParser::parseIptc(const QByteArray &iptcData, QSet<QString> &tags) {
+    const uchar *data = (const uchar *) iptcData.constData();
+    qint64 size = iptcData.size();
+    qint64 pos = 0;
+
+    while (pos + 5 <= size) {
+        /* Skip garbage between datasets the same way Exiv2 does */
+        if (data[pos] != 0x1C) {
+            ++pos;
+            continue;
+        }
+
+        uchar record = data[pos + 1];
+        uchar dataSet = data[pos + 2];
+        qint64 dataSize = qFromBigEndian<quint16>(data + pos + 3);
+        pos += 5;
+
+        /* Extended dataset, the size field holds the length of the real size field */
+        if (dataSize & 0x8000) {
+            int sizeLength = dataSize & 0x7FFF;
+            if (sizeLength > 4 || pos + sizeLength > size) {
+                break;
+            }
+            dataSize = 0;
+            for (int i = 0; i < sizeLength; ++i) {
+                dataSize = (dataSize << 8) | data[pos + i];
+            }
+            pos += sizeLength;
+        }
+
+        if (dataSize > size - pos) {
+            break;
+        }
+
+        /* Iptc.Application2.Keywords */
+        if (record == 2 && dataSet == 25) {
+            tags.insert(QString::fromUtf8((const char *) data + pos, dataSize));
+        }
+
+        pos += dataSize;
+    }
+}
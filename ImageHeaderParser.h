@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_HEADER_PARSER_H
+#define IMAGE_HEADER_PARSER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <QSet>
+
+/*
+ * Reads the Exif orientation and the IPTC keywords straight from the JPEG
+ * APP1/APP13 segments or from the first TIFF IFD, without a full Exiv2 parse.
+ * Only the segment headers and the metadata blocks themselves are read.
+ */
+class ImageHeaderParser {
+
+public:
+    /* Returns false when the format is not handled here and Exiv2 should be used instead */
+    static bool readMetadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags);
+
+private:
+    static bool parseJpeg(QIODevice &device, long &orientation, QSet<QString> &tags);
+
+    static bool parseTiff(QIODevice &device, long &orientation, QSet<QString> *tags);
+
+    static void parsePhotoshopResources(const QByteArray &resources, QSet<QString> &tags);
+
+    static void parseIptc(const QByteArray &iptcData, QSet<QString> &tags);
+};
+
+#endif // IMAGE_HEADER_PARSER_H
@@ -0,0 +1,196 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QImageReader>
+#include "ImageLoader.h"
+#include "TiledImage.h"
+#include "AnimationPlayer.h"
+
+class ImageLoadTask : public QRunnable {
+
+public:
+    ImageLoadTask(ImageLoader *imageLoader, int generation, const QString &imageFileName, const QSize &previewSize,
+                  const ImageProcessor::Parameters &parameters, bool animationsEnabled, bool tilingEnabled) {
+        this->imageLoader = imageLoader;
+        this->generation = generation;
+        this->imageFileName = imageFileName;
+        this->previewSize = previewSize;
+        this->parameters = parameters;
+        this->animationsEnabled = animationsEnabled;
+        this->tilingEnabled = tilingEnabled;
+    }
+
+    void run() {
+        imageLoader->loadImage(generation, imageFileName, previewSize, parameters, animationsEnabled, tilingEnabled);
+    }
+
+private:
+    ImageLoader *imageLoader;
+    int generation;
+    QString imageFileName;
+    QSize previewSize;
+    ImageProcessor::Parameters parameters;
+    bool animationsEnabled;
+    bool tilingEnabled;
+};
+
+ImageLoader::ImageLoader(QObject *parent, ImageCache *imageCache, ImagePrefetcher *imagePrefetcher)
+        : QObject(parent) {
+    this->imageCache = imageCache;
+    this->imagePrefetcher = imagePrefetcher;
+    loading = false;
+    hasResult = false;
+
+    /* One at a time, queued loads behind it are superseded anyway */
+    threadPool.setMaxThreadCount(1);
+}
+
+ImageLoader::~ImageLoader() {
+    cancel();
+    threadPool.clear();
+    threadPool.waitForDone();
+}
+
+void ImageLoader::load(const QString &imageFileName, const QSize &previewSize,
+                       const ImageProcessor::Parameters &parameters, bool animationsEnabled, bool tilingEnabled) {
+    QMutexLocker locker(&mutex);
+    int loadGeneration = generation.fetchAndAddOrdered(1) + 1;
+    loading = true;
+    hasResult = false;
+    result = Result();
+    threadPool.start(new ImageLoadTask(this, loadGeneration, imageFileName, previewSize, parameters,
+                                       animationsEnabled, tilingEnabled));
+}
+
+void ImageLoader::cancel() {
+    QMutexLocker locker(&mutex);
+    generation.fetchAndAddOrdered(1);
+    loading = false;
+    hasResult = false;
+    result = Result();
+}
+
+bool ImageLoader::isLoading() {
+    QMutexLocker locker(&mutex);
+    return loading;
+}
+
+bool ImageLoader::takeResult(Result &result) {
+    QMutexLocker locker(&mutex);
+    if (!hasResult) {
+        return false;
+    }
+
+    result = this->result;
+    this->result = Result();
+    hasResult = false;
+    return true;
+}
+
+bool ImageLoader::isSuperseded(int generation) {
+    return generation != this->generation.loadAcquire();
+}
+
+/* Runs on the worker thread */
+void ImageLoader::loadImage(int generation, const QString &imageFileName, const QSize &previewSize,
+                            const ImageProcessor::Parameters &parameters, bool animationsEnabled,
+                            bool tilingEnabled) {
+    if (isSuperseded(generation)) {
+        return;
+    }
+
+    Result loadResult;
+    loadResult.previewScale = 1.0;
+    loadResult.animated = false;
+    loadResult.tiled = false;
+    QImageReader imageReader(imageFileName);
+    loadResult.fullImageSize = imageReader.size();
+
+    /* Counting the frames may have to read the whole file */
+    if (animationsEnabled && AnimationPlayer::isAnimated(imageReader)) {
+        loadResult.animated = true;
+        setResult(generation, loadResult);
+        return;
+    }
+
+    /* Too large to decode in one piece, only the base of the pyramid is decoded here */
+    if (tilingEnabled && TiledImage::isTileable(imageReader)
+        && TiledImage::isTileable(loadResult.fullImageSize, parameters)) {
+        loadResult.baseImage = imageCache->loadScaled(imageFileName,
+                                                      QSize(TILED_BASE_LEVEL_SIZE, TILED_BASE_LEVEL_SIZE));
+        if (!loadResult.baseImage.isNull()) {
+            loadResult.sourceBaseImage = loadResult.baseImage;
+            if (parameters.applyColors) {
+                ImageProcessor::colorize(loadResult.baseImage, parameters);
+            }
+            loadResult.tiled = true;
+            setResult(generation, loadResult);
+            return;
+        }
+    }
+
+    /* Served from the image cache when the file was prefetched or viewed recently */
+    bool imageLoaded = imagePrefetcher->take(imageFileName, loadResult.origImage);
+
+    /* Until the user zooms in, crops or saves, a screen sized decode is all that is shown */
+    QSize fullImageSize = loadResult.fullImageSize;
+    if (!imageLoaded && fullImageSize.isValid() && previewSize.isValid()
+        && (fullImageSize.width() > previewSize.width() || fullImageSize.height() > previewSize.height())) {
+        loadResult.origImage = imageCache->loadScaled(imageFileName, previewSize);
+        if (!loadResult.origImage.isNull()) {
+            loadResult.previewScale = (qreal) fullImageSize.width() / loadResult.origImage.width();
+            imageLoaded = true;
+        }
+    }
+
+    if (!imageLoaded && fullImageSize.isValid() && imageReader.read(&loadResult.origImage)) {
+        imageCache->insert(imageFileName, loadResult.origImage);
+        imageLoaded = true;
+    }
+
+    if (isSuperseded(generation)) {
+        return;
+    }
+
+    if (imageLoaded) {
+        loadResult.viewerImage = ImageProcessor::process(loadResult.origImage, parameters);
+    } else {
+        loadResult.origImage = QImage();
+        loadResult.errorString = imageReader.errorString();
+    }
+
+    setResult(generation, loadResult);
+}
+
+void ImageLoader::setResult(int generation, const Result &loadResult) {
+    QMutexLocker locker(&mutex);
+    if (isSuperseded(generation)) {
+        return;
+    }
+    result = loadResult;
+    hasResult = true;
+    loading = false;
+    QMetaObject::invokeMethod(this, "onImageLoaded", Qt::QueuedConnection, Q_ARG(int, generation));
+}
+
+void ImageLoader::onImageLoaded(int generation) {
+    if (!isSuperseded(generation)) {
+        emit imageLoaded();
+    }
+}
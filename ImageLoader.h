@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QImage>
+#include <QString>
+#include <QSize>
+#include "ImageCache.h"
+#include "ImagePrefetcher.h"
+#include "ImageProcessor.h"
+
+/*
+ * Decodes and processes the image the viewer is about to show on a worker thread.
+ * Every load gets a new generation, a load superseded before it started is skipped
+ * and the result of one superseded while running is dropped, so holding down
+ * a navigation key only ever decodes the latest image.
+ */
+class ImageLoader : public QObject {
+Q_OBJECT
+
+public:
+    struct Result {
+        QImage origImage;
+        QImage viewerImage;
+        QSize fullImageSize;
+        qreal previewScale;
+        QString errorString;
+        /* Played by an animation player, nothing is decoded here */
+        bool animated;
+        /* Shown as a tile pyramid over baseImage, which has the color edits applied, instead of origImage */
+        bool tiled;
+        QImage baseImage;
+        /* baseImage before the color edits, colored again when they change */
+        QImage sourceBaseImage;
+    };
+
+    ImageLoader(QObject *parent, ImageCache *imageCache, ImagePrefetcher *imagePrefetcher);
+
+    ~ImageLoader();
+
+    /* Images larger than previewSize are decoded scaled down to fit it, or tiled when tilingEnabled allows.
+     * An invalid previewSize always decodes the full image. */
+    void load(const QString &imageFileName, const QSize &previewSize, const ImageProcessor::Parameters &parameters,
+              bool animationsEnabled, bool tilingEnabled);
+
+    /* Drops the pending load, if any */
+    void cancel();
+
+    bool isLoading();
+
+    /* Returns false when there is no result for the latest load, or it was already taken */
+    bool takeResult(Result &result);
+
+    void loadImage(int generation, const QString &imageFileName, const QSize &previewSize,
+                   const ImageProcessor::Parameters &parameters, bool animationsEnabled, bool tilingEnabled);
+
+signals:
+
+    void imageLoaded();
+
+private slots:
+
+    void onImageLoaded(int generation);
+
+private:
+    QThreadPool threadPool;
+    QMutex mutex;
+    QAtomicInt generation;
+    bool loading;
+    bool hasResult;
+    Result result;
+    ImageCache *imageCache;
+    ImagePrefetcher *imagePrefetcher;
+
+    bool isSuperseded(int generation);
+
+    void setResult(int generation, const Result &loadResult);
+};
+
+#endif // IMAGE_LOADER_H
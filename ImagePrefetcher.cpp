@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QImageReader>
+#include "ImagePrefetcher.h"
+#include "TiledImage.h"
+
+class ImagePrefetchTask : public QRunnable {
+
+public:
+    ImagePrefetchTask(ImagePrefetcher *imagePrefetcher, const QString &imageFileName, bool fullResolution) {
+        this->imagePrefetcher = imagePrefetcher;
+        this->imageFileName = imageFileName;
+        this->fullResolution = fullResolution;
+    }
+
+    void run() {
+        imagePrefetcher->decode(imageFileName, fullResolution);
+    }
+
+private:
+    ImagePrefetcher *imagePrefetcher;
+    QString imageFileName;
+    bool fullResolution;
+};
+
+ImagePrefetcher::ImagePrefetcher(QObject *parent, ImageCache *imageCache) : QObject(parent) {
+    this->imageCache = imageCache;
+    threadPool.setMaxThreadCount(PREFETCH_THREADS);
+}
+
+ImagePrefetcher::~ImagePrefetcher() {
+    clear();
+    threadPool.waitForDone();
+}
+
+void ImagePrefetcher::prefetch(const QStringList &imageFileNames) {
+    QMutexLocker locker(&mutex);
+
+    /* Queued decodes for images we moved away from turn into no-ops */
+    for (int i = 0; i < imageFileNames.size(); ++i) {
+        const QString &imageFileName = imageFileNames.at(i);
+        if (!wantedImages.contains(imageFileName)) {
+            threadPool.start(new ImagePrefetchTask(this, imageFileName, false));
+        }
+    }
+
+    wantedImages = imageFileNames.toSet();
+}
+
+void ImagePrefetcher::setPreviewSize(const QSize &previewSize) {
+    QMutexLocker locker(&mutex);
+    this->previewSize = previewSize;
+}
+
+void ImagePrefetcher::setFullImage(const QString &imageFileName) {
+    QMutexLocker locker(&mutex);
+    if (imageFileName == wantedFullImage) {
+        return;
+    }
+
+    wantedFullImage = imageFileName;
+    if (!imageFileName.isEmpty()) {
+        threadPool.start(new ImagePrefetchTask(this, imageFileName, true));
+    }
+}
+
+/* Runs on a worker thread */
+void ImagePrefetcher::decode(const QString &imageFileName, bool fullResolution) {
+    QImage image;
+    QSize scaledSize;
+
+    if (fullResolution) {
+        {
+            QMutexLocker locker(&mutex);
+            if (imageFileName != wantedFullImage) {
+                return;
+            }
+        }
+
+        if (!imageCache->find(imageFileName, image)) {
+            QImageReader imageReader(imageFileName);
+            if (!imageReader.read(&image)) {
+                return;
+            }
+            imageCache->insert(imageFileName, image);
+        }
+
+        emit fullImageDecoded(imageFileName, image);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        if (!wantedImages.contains(imageFileName) || decodingImages.contains(imageFileName)) {
+            return;
+        }
+        decodingImages.insert(imageFileName);
+        scaledSize = previewSize;
+    }
+
+    if (scaledSize.isValid()) {
+        imageCache->loadScaled(imageFileName, scaledSize);
+    } else if (!imageCache->find(imageFileName, image)) {
+        /* Tiled images are never decoded whole for viewing */
+        QImageReader imageReader(imageFileName);
+        if (imageReader.size().isValid() && !TiledImage::isTileable(imageReader) && imageReader.read(&image)) {
+            imageCache->insert(imageFileName, image);
+        }
+    }
+
+    QMutexLocker locker(&mutex);
+    decodingImages.remove(imageFileName);
+    decodeDone.wakeAll();
+}
+
+bool ImagePrefetcher::take(const QString &imageFileName, QImage &image) {
+    QMutexLocker locker(&mutex);
+
+    while (decodingImages.contains(imageFileName)) {
+        decodeDone.wait(&mutex);
+    }
+
+    /* Not started yet, the caller decodes it right away instead of waiting in the queue */
+    wantedImages.remove(imageFileName);
+
+    return imageCache->find(imageFileName, image);
+}
+
+void ImagePrefetcher::clear() {
+    QMutexLocker locker(&mutex);
+    wantedImages.clear();
+    wantedFullImage.clear();
+}
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_PREFETCHER_H
+#define IMAGE_PREFETCHER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include <QStringList>
+#include <QSize>
+#include "ImageCache.h"
+
+#define PREFETCH_AHEAD_COUNT 2
+#define PREFETCH_BEHIND_COUNT 1
+#define SLIDESHOW_PREFETCH_COUNT 3
+#define PREFETCH_THREADS 2
+
+/*
+ * Decodes the images the viewer is likely to show next on background threads
+ * into the shared image cache, at the preview size when one is set.
+ * Also decodes the current image at full resolution when the viewer needs it.
+ */
+class ImagePrefetcher : public QObject {
+Q_OBJECT
+
+public:
+    ImagePrefetcher(QObject *parent, ImageCache *imageCache);
+
+    ~ImagePrefetcher();
+
+    void prefetch(const QStringList &imageFileNames);
+
+    /* Prefetched images larger than this are only decoded scaled down to fit it */
+    void setPreviewSize(const QSize &previewSize);
+
+    /* Decodes the image at full resolution in the background, an empty name cancels */
+    void setFullImage(const QString &imageFileName);
+
+    /* Returns false when the image was not prefetched, waits if it is being decoded right now */
+    bool take(const QString &imageFileName, QImage &image);
+
+    void clear();
+
+    void decode(const QString &imageFileName, bool fullResolution);
+
+signals:
+
+    void fullImageDecoded(const QString &imageFileName, const QImage &image);
+
+private:
+    QThreadPool threadPool;
+    QMutex mutex;
+    QWaitCondition decodeDone;
+    QSet<QString> wantedImages;
+    QSet<QString> decodingImages;
+    QString wantedFullImage;
+    QSize previewSize;
+    ImageCache *imageCache;
+};
+
+#endif // IMAGE_PREFETCHER_H
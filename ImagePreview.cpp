@@ -22,8 +22,7 @@
 
 ImagePreview::ImagePreview(QWidget *parent) : QWidget(parent) {
 
-    imageLabel = new QLabel;
-    imageLabel->setScaledContents(true);
+    imageView = new ImageView;
 
     scrollArea = new QScrollArea;
     scrollArea->setContentsMargins(0, 0, 0, 0);
@@ -33,7 +32,7 @@ ImagePreview::ImagePreview(QWidget *parent) : QWidget(parent) {
     scrollArea->verticalScrollBar()->blockSignals(true);
     scrollArea->horizontalScrollBar()->blockSignals(true);
     scrollArea->setFrameStyle(0);
-    scrollArea->setWidget(imageLabel);
+    scrollArea->setWidget(imageView);
     scrollArea->setWidgetResizable(true);
 
     QHBoxLayout *mainLayout = new QHBoxLayout();
@@ -45,44 +44,41 @@ ImagePreview::ImagePreview(QWidget *parent) : QWidget(parent) {
     setLayout(mainLayout);
 }
 
-QPixmap& ImagePreview::loadImage(QString imageFileName) {
-    QImageReader imageReader(imageFileName);
-    if (imageReader.size().isValid()) {
-        QSize resize = imageReader.size();
-        resize.scale(QSize(imageLabel->width(), imageLabel->height()), Qt::KeepAspectRatio);
-        QImage previewImage;
-        imageReader.read(&previewImage);
+QImage ImagePreview::loadImage(QString imageFileName) {
+    /* Shares decodes with the viewer through the image cache, square bounds so Exif rotation does not matter */
+    int previewSide = qMax(qMax(scrollArea->width(), scrollArea->height()), BAD_IMAGE_SIZE);
+    QImage previewImage = imageViewer->imageCache->loadScaled(imageFileName, QSize(previewSide, previewSide));
+    if (!previewImage.isNull()) {
         if (Settings::exifRotationEnabled) {
             imageViewer->rotateByExifRotation(previewImage, imageFileName);
         }
-        previewPixmap = QPixmap::fromImage(previewImage);
     } else {
-        previewPixmap = QIcon::fromTheme("image-missing",
-                                         QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE, BAD_IMAGE_SIZE);
+        previewImage = QIcon::fromTheme("image-missing",
+                                        QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE,
+                                                                                  BAD_IMAGE_SIZE).toImage();
     }
 
-    imageLabel->setPixmap(previewPixmap);
+    imageView->setImage(previewImage);
     resizeImagePreview();
-    return previewPixmap;
+    return previewImage;
 }
 
 void ImagePreview::clear() {
-    imageLabel->clear();
+    imageView->clear();
 }
 
 void ImagePreview::resizeImagePreview() {
-    const QPixmap *pixmap = imageLabel->pixmap();
-    if (!pixmap) {
+    if (!imageView->hasImage()) {
         return;
     }
 
-    QSize previewSizePixmap = pixmap->size();
+    QSize previewSizePixmap = imageView->getImageSize();
     if (previewSizePixmap.width() > scrollArea->width() || previewSizePixmap.height() > scrollArea->height()) {
         previewSizePixmap.scale(scrollArea->width(), scrollArea->height(), Qt::KeepAspectRatio);
     }
 
-    imageLabel->setFixedSize(previewSizePixmap);
-    imageLabel->adjustSize();
+    imageView->setFixedSize(previewSizePixmap);
+    imageView->adjustSize();
 }
 
 void ImagePreview::resizeEvent(QResizeEvent *event) {
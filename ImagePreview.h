@@ -28,7 +28,7 @@ Q_OBJECT
 public:
     ImagePreview(QWidget *parent);
 
-    QPixmap &loadImage(QString imageFileName);
+    QImage loadImage(QString imageFileName);
 
     void resizeImagePreview();
 
@@ -44,8 +44,7 @@ protected:
     void resizeEvent(QResizeEvent *event);
 
 private:
-    QLabel *imageLabel;
-    QPixmap previewPixmap;
+    ImageView *imageView;
     ImageViewer *imageViewer;
 
 };
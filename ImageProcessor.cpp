@@ -0,0 +1,260 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QTransform>
+#include <QPainter>
+#include "ImageProcessor.h"
+#include "ColorizeKernel.h"
+#include "ColorLut.h"
+#include "OrientationKernel.h"
+#include "ImageViewer.h"
+#include "Settings.h"
+
+ImageProcessor::Parameters ImageProcessor::getParameters(long exifOrientation) {
+    Parameters parameters;
+    parameters.exifOrientation = exifOrientation;
+    parameters.rotation = Settings::rotation;
+    parameters.flipH = Settings::flipH;
+    parameters.flipV = Settings::flipV;
+    parameters.scaledWidth = Settings::scaledWidth;
+    parameters.scaledHeight = Settings::scaledHeight;
+    parameters.cropLeft = Settings::cropLeft;
+    parameters.cropTop = Settings::cropTop;
+    parameters.cropWidth = Settings::cropWidth;
+    parameters.cropHeight = Settings::cropHeight;
+    parameters.cropLeftPercent = Settings::cropLeftPercent;
+    parameters.cropTopPercent = Settings::cropTopPercent;
+    parameters.cropWidthPercent = Settings::cropWidthPercent;
+    parameters.cropHeightPercent = Settings::cropHeightPercent;
+    parameters.applyColors = Settings::colorsActive || Settings::keepTransform;
+    parameters.colorizeEnabled = Settings::colorizeEnabled;
+    parameters.hueVal = Settings::hueVal;
+    parameters.saturationVal = Settings::saturationVal;
+    parameters.lightnessVal = Settings::lightnessVal;
+    parameters.contrastVal = Settings::contrastVal;
+    parameters.brightVal = Settings::brightVal;
+    parameters.redVal = Settings::redVal;
+    parameters.greenVal = Settings::greenVal;
+    parameters.blueVal = Settings::blueVal;
+    parameters.rNegateEnabled = Settings::rNegateEnabled;
+    parameters.gNegateEnabled = Settings::gNegateEnabled;
+    parameters.bNegateEnabled = Settings::bNegateEnabled;
+    parameters.hueRedChannel = Settings::hueRedChannel;
+    parameters.hueGreenChannel = Settings::hueGreenChannel;
+    parameters.hueBlueChannel = Settings::hueBlueChannel;
+    return parameters;
+}
+
+QImage ImageProcessor::process(const QImage &image, const Parameters &parameters) {
+    QImage processedImage = image;
+    transform(processedImage, parameters);
+
+    if (parameters.applyColors) {
+        colorize(processedImage, parameters);
+    } else {
+        ColorLut::release();
+    }
+
+    return processedImage;
+}
+
+void ImageProcessor::rotateByExifOrientation(QImage &image, long orientation) {
+    image = OrientationKernel::apply(image, orientation);
+}
+
+/* Appends an orthogonal step to the mapping, size is updated to the size after the step */
+static void mirrorTransform(QTransform &matrix, QSize &size, bool horizontal, bool vertical) {
+    matrix *= QTransform(horizontal ? -1 : 1, 0, 0, vertical ? -1 : 1,
+                         horizontal ? size.width() : 0, vertical ? size.height() : 0);
+}
+
+static void rotateTransform(QTransform &matrix, QSize &size, int degrees) {
+    QTransform rotation;
+    rotation.rotate(degrees);
+
+    /* Same placement as QImage::transformed(), the rotated image starts at 0,0 */
+    QRect rotatedRect = rotation.mapRect(QRectF(QPointF(0, 0), size)).toAlignedRect();
+    matrix *= rotation * QTransform::fromTranslate(-rotatedRect.x(), -rotatedRect.y());
+    size = rotatedRect.size();
+}
+
+QTransform ImageProcessor::getTransform(const QSize &imageSize, const Parameters &parameters,
+                                        QSize &transformedSize) {
+    QTransform matrix;
+    QSize size = imageSize;
+
+    if (parameters.scaledWidth && QSize(parameters.scaledWidth, parameters.scaledHeight) != size) {
+        matrix.scale((qreal) parameters.scaledWidth / size.width(), (qreal) parameters.scaledHeight / size.height());
+        size = QSize(parameters.scaledWidth, parameters.scaledHeight);
+    }
+
+    switch (parameters.exifOrientation) {
+        case 2:
+            mirrorTransform(matrix, size, true, false);
+            break;
+        case 3:
+            rotateTransform(matrix, size, 180);
+            break;
+        case 4:
+            mirrorTransform(matrix, size, false, true);
+            break;
+        case 5:
+            rotateTransform(matrix, size, 90);
+            mirrorTransform(matrix, size, true, false);
+            break;
+        case 6:
+            rotateTransform(matrix, size, 90);
+            break;
+        case 7:
+            rotateTransform(matrix, size, 90);
+            mirrorTransform(matrix, size, false, true);
+            break;
+        case 8:
+            rotateTransform(matrix, size, 270);
+            break;
+        default:
+            break;
+    }
+
+    if (parameters.rotation % 360) {
+        rotateTransform(matrix, size, parameters.rotation);
+    }
+
+    if (parameters.flipH || parameters.flipV) {
+        mirrorTransform(matrix, size, parameters.flipH, parameters.flipV);
+    }
+
+    int cropLeft = parameters.cropLeft + (size.width() * parameters.cropLeftPercent) / 100;
+    int cropTop = parameters.cropTop + (size.height() * parameters.cropTopPercent) / 100;
+    int cropRight = parameters.cropWidth + (size.width() * parameters.cropWidthPercent) / 100;
+    int cropBottom = parameters.cropHeight + (size.height() * parameters.cropHeightPercent) / 100;
+    if (cropLeft || cropTop || cropRight || cropBottom) {
+        matrix *= QTransform::fromTranslate(-cropLeft, -cropTop);
+        size = QSize(size.width() - cropLeft - cropRight, size.height() - cropTop - cropBottom);
+    }
+
+    transformedSize = size;
+    return matrix;
+}
+
+void ImageProcessor::transform(QImage &image, const Parameters &parameters) {
+    /* Reducing averages pixels, which a single sampling pass cannot do, so it goes first */
+    if (parameters.scaledWidth
+        && (qint64) parameters.scaledWidth * parameters.scaledHeight < (qint64) image.width() * image.height()) {
+        image = image.scaled(parameters.scaledWidth, parameters.scaledHeight,
+                             Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QSize transformedSize;
+    QTransform matrix = getTransform(image.size(), parameters, transformedSize);
+    if (transformedSize.isEmpty()) {
+        image = QImage();
+        return;
+    }
+
+    if (matrix.type() == QTransform::TxNone && transformedSize == image.size()) {
+        return;
+    }
+
+    /* A crop alone needs no resampling */
+    if (matrix.type() == QTransform::TxTranslate) {
+        image = image.copy(QRect(QPoint(qRound(-matrix.dx()), qRound(-matrix.dy())), transformedSize));
+        return;
+    }
+
+    /* Orientation, quarter turns and flips without scaling are an exact pixel shuffle, then a crop */
+    long orientation = OrientationKernel::getOrientation(matrix);
+    if (orientation) {
+        QPoint cropOrigin = -matrix.mapRect(QRectF(QPointF(0, 0), image.size())).topLeft().toPoint();
+        image = OrientationKernel::apply(image, orientation);
+        if (transformedSize != image.size()) {
+            image = image.copy(QRect(cropOrigin, transformedSize));
+        }
+        return;
+    }
+
+    /* Free rotation leaves transparent corners */
+    bool isOrthogonal = (matrix.m12() == 0 && matrix.m21() == 0) || (matrix.m11() == 0 && matrix.m22() == 0);
+    bool hasAlpha = image.hasAlphaChannel() || !isOrthogonal;
+    QImage transformedImage(transformedSize, hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    if (transformedImage.isNull()) {
+        image = QImage();
+        return;
+    }
+    transformedImage.fill(hasAlpha ? Qt::transparent : Qt::black);
+
+    QPainter painter(&transformedImage);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setTransform(matrix);
+    painter.drawImage(0, 0, image);
+    painter.end();
+
+    image = transformedImage;
+}
+
+QSize ImageProcessor::getMirrorGrid(int mirrorLayout) {
+    switch (mirrorLayout) {
+        case ImageViewer::LayDual:
+            return QSize(2, 1);
+        case ImageViewer::LayTriple:
+            return QSize(3, 1);
+        case ImageViewer::LayQuad:
+            return QSize(2, 2);
+        case ImageViewer::LayVDual:
+            return QSize(1, 2);
+        default:
+            return QSize(1, 1);
+    }
+}
+
+QTransform ImageProcessor::getMirrorCellTransform(int column, int row, const QSize &cellSize) {
+    int flipH = column % 2;
+    int flipV = row % 2;
+    return QTransform(flipH ? -1 : 1, 0, 0, flipV ? -1 : 1,
+                      (column + flipH) * cellSize.width(), (row + flipV) * cellSize.height());
+}
+
+void ImageProcessor::mirror(QImage &image, int mirrorLayout) {
+    QSize grid = getMirrorGrid(mirrorLayout);
+    if (grid == QSize(1, 1)) {
+        return;
+    }
+
+    QImage mirrorImage(image.width() * grid.width(), image.height() * grid.height(), QImage::Format_ARGB32);
+    QPainter painter(&mirrorImage);
+    for (int row = 0; row < grid.height(); ++row) {
+        for (int column = 0; column < grid.width(); ++column) {
+            painter.setTransform(getMirrorCellTransform(column, row, image.size()));
+            painter.drawImage(0, 0, image);
+        }
+    }
+    painter.end();
+
+    image = mirrorImage;
+}
+
+void ImageProcessor::colorize(QImage &image, const Parameters &parameters) {
+    QSharedPointer<ColorLut> colorLut = ColorLut::find(parameters, (qint64) image.width() * image.height());
+    if (colorLut) {
+        colorLut->apply(image);
+        return;
+    }
+
+    ColorizeKernel colorizeKernel(parameters);
+    colorizeKernel.apply(image);
+}
@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_PROCESSOR_H
+#define IMAGE_PROCESSOR_H
+
+#include <QImage>
+#include <QTransform>
+
+/*
+ * The viewer's editing pipeline: scaling, Exif orientation, rotation, flipping, cropping
+ * and color adjustments. Works on a snapshot of the parameters and touches no shared state,
+ * so it can run on any thread. Mirror layouts are drawn by the views at paint time, mirror()
+ * only renders one for saving and copying.
+ */
+class ImageProcessor {
+
+public:
+    struct Parameters {
+        long exifOrientation;
+        int rotation;
+        bool flipH;
+        bool flipV;
+        int scaledWidth;
+        int scaledHeight;
+        int cropLeft;
+        int cropTop;
+        int cropWidth;
+        int cropHeight;
+        int cropLeftPercent;
+        int cropTopPercent;
+        int cropWidthPercent;
+        int cropHeightPercent;
+        bool applyColors;
+        bool colorizeEnabled;
+        int hueVal;
+        int saturationVal;
+        int lightnessVal;
+        int contrastVal;
+        int brightVal;
+        int redVal;
+        int greenVal;
+        int blueVal;
+        bool rNegateEnabled;
+        bool gNegateEnabled;
+        bool bNegateEnabled;
+        bool hueRedChannel;
+        bool hueGreenChannel;
+        bool hueBlueChannel;
+    };
+
+    /* Snapshot of the current settings, exifOrientation is 0 when Exif rotation is disabled */
+    static Parameters getParameters(long exifOrientation);
+
+    static QImage process(const QImage &image, const Parameters &parameters);
+
+    static void rotateByExifOrientation(QImage &image, long orientation);
+
+    /* Scaling, orientation, rotation, flips and crop composed into one mapping of source pixels */
+    static QTransform getTransform(const QSize &imageSize, const Parameters &parameters, QSize &transformedSize);
+
+    static void transform(QImage &image, const Parameters &parameters);
+
+    static void colorize(QImage &image, const Parameters &parameters);
+
+    /* Copies across and down in a mirror layout, odd columns are flipped horizontally and odd rows vertically */
+    static QSize getMirrorGrid(int mirrorLayout);
+
+    /* Maps the pixels of one copy to its cell of a mirror layout */
+    static QTransform getMirrorCellTransform(int column, int row, const QSize &cellSize);
+
+    static void mirror(QImage &image, int mirrorLayout);
+};
+
+#endif // IMAGE_PROCESSOR_H
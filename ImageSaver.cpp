@@ -0,0 +1,235 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <exiv2/exiv2.hpp>
+#include "ImageSaver.h"
+#include "LosslessJpeg.h"
+#include "OrientationKernel.h"
+
+class ImageSaveTask : public QRunnable {
+
+public:
+    ImageSaveTask(ImageSaver *imageSaver, const ImageSaver::Request &request) {
+        this->imageSaver = imageSaver;
+        this->request = request;
+    }
+
+    void run() {
+        QString errorString;
+        bool metadataSaved = false;
+        if (!ImageSaver::saveImage(request, errorString, metadataSaved) && errorString.isEmpty()) {
+            errorString = "Unknown error";
+        }
+        QMetaObject::invokeMethod(imageSaver, "onImageSaved", Qt::QueuedConnection,
+                                  Q_ARG(QString, request.sourceFileName), Q_ARG(QString, request.fileName),
+                                  Q_ARG(QString, errorString), Q_ARG(bool, metadataSaved));
+    }
+
+private:
+    ImageSaver *imageSaver;
+    ImageSaver::Request request;
+};
+
+ImageSaver::ImageSaver(QObject *parent) : QObject(parent) {
+    pendingSaves = 0;
+
+    /* Saves of the same file must land in the order they were requested */
+    threadPool.setMaxThreadCount(1);
+}
+
+ImageSaver::~ImageSaver() {
+    threadPool.waitForDone();
+}
+
+void ImageSaver::save(const Request &request) {
+    ++pendingSaves;
+    threadPool.start(new ImageSaveTask(this, request));
+}
+
+bool ImageSaver::isSaving() {
+    return pendingSaves > 0;
+}
+
+void ImageSaver::onImageSaved(QString sourceFileName, QString fileName, QString errorString, bool metadataSaved) {
+    --pendingSaves;
+    emit imageSaved(sourceFileName, fileName, errorString, metadataSaved);
+}
+
+/* Orientation, quarter turns, flips and crops alone can be redone on the JPEG coefficients of the source */
+void ImageSaver::setLosslessTransform(Request &request, const QSize &imageSize,
+                                      const ImageProcessor::Parameters &parameters) {
+    request.losslessOrientation = 0;
+    if (parameters.applyColors || !imageSize.isValid()) {
+        return;
+    }
+
+    QSize transformedSize;
+    QTransform matrix = ImageProcessor::getTransform(imageSize, parameters, transformedSize);
+    long orientation = OrientationKernel::getOrientation(matrix);
+    if (!orientation || transformedSize.isEmpty()) {
+        return;
+    }
+
+    /* The crop offset is where the uncropped transform places the origin */
+    ImageProcessor::Parameters orientParameters = parameters;
+    orientParameters.cropLeft = orientParameters.cropTop = orientParameters.cropWidth = orientParameters.cropHeight = 0;
+    orientParameters.cropLeftPercent = orientParameters.cropTopPercent = 0;
+    orientParameters.cropWidthPercent = orientParameters.cropHeightPercent = 0;
+    QSize orientedSize;
+    QTransform orientedMatrix = ImageProcessor::getTransform(imageSize, orientParameters, orientedSize);
+
+    request.losslessOrientation = orientation;
+    request.losslessCrop = QRect(QPoint(qRound(orientedMatrix.dx() - matrix.dx()),
+                                        qRound(orientedMatrix.dy() - matrix.dy())), transformedSize);
+}
+
+/* Runs on the worker thread */
+bool ImageSaver::saveImage(const Request &request, QString &errorString, bool &metadataSaved) {
+    QByteArray imageFormat = request.format;
+    if (imageFormat.isEmpty()) {
+        imageFormat = QFileInfo(request.fileName).suffix().toLower().toLatin1();
+    }
+
+    /* Straight from the source coefficients, no generation loss */
+    QByteArray imageData;
+    bool encoded = false;
+    if (request.losslessOrientation && (imageFormat == "jpeg" || imageFormat == "jpg")) {
+        QFile sourceFile(request.sourceFileName);
+        QString transformError;
+        encoded = sourceFile.open(QIODevice::ReadOnly)
+                  && LosslessJpeg::transform(sourceFile.readAll(), request.losslessOrientation,
+                                             request.losslessCrop, false, imageData, transformError);
+    }
+
+    if (!encoded) {
+        imageData.clear();
+        QBuffer imageBuffer(&imageData);
+        imageBuffer.open(QIODevice::WriteOnly);
+        QImageWriter imageWriter(&imageBuffer, imageFormat);
+        imageWriter.setQuality(request.quality);
+        if (!imageWriter.write(request.image)) {
+            errorString = imageWriter.errorString();
+            return false;
+        }
+        imageBuffer.close();
+    }
+
+    metadataSaved = copyMetadata(request.sourceFileName, imageData, request.resetOrientation);
+    return writeFile(request.fileName, imageData, errorString);
+}
+
+/* Runs on batch job threads */
+bool ImageSaver::normalizeOrientation(const QString &fileName, QString &errorString) {
+    QFile imageFile(fileName);
+    if (!imageFile.open(QIODevice::ReadOnly)) {
+        errorString = imageFile.errorString();
+        return false;
+    }
+    QByteArray jpegData = imageFile.readAll();
+    imageFile.close();
+
+    if (!LosslessJpeg::isJpeg(jpegData)) {
+        errorString = tr("Not a JPEG image");
+        return false;
+    }
+
+    long orientation = 0;
+    try {
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open((const Exiv2::byte *) jpegData.constData(),
+                                                                jpegData.size());
+        image->readMetadata();
+        Exiv2::ExifData::iterator orientationDatum = image->exifData().findKey(
+                Exiv2::ExifKey("Exif.Image.Orientation"));
+        if (orientationDatum != image->exifData().end()) {
+            orientation = orientationDatum->toLong();
+        }
+    }
+    catch (Exiv2::Error &error) {
+        errorString = QString::fromUtf8(error.what());
+        return false;
+    }
+
+    /* Already upright */
+    if (orientation <= 1 || orientation > 8) {
+        return true;
+    }
+
+    QByteArray normalizedData;
+    if (!LosslessJpeg::transform(jpegData, orientation, QRect(), true, normalizedData, errorString)) {
+        return false;
+    }
+
+    /* The metadata came along with the markers, only the orientation changes */
+    if (!copyMetadata(fileName, normalizedData, true)) {
+        errorString = tr("Failed to reset the Exif orientation");
+        return false;
+    }
+
+    return writeFile(fileName, normalizedData, errorString);
+}
+
+/* Inserts the metadata of the source file into the encoded image, without touching the disk */
+bool ImageSaver::copyMetadata(const QString &sourceFileName, QByteArray &imageData, bool resetOrientation) {
+    try {
+        Exiv2::Image::AutoPtr sourceImage = Exiv2::ImageFactory::open(sourceFileName.toStdString());
+        sourceImage->readMetadata();
+
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open((const Exiv2::byte *) imageData.constData(),
+                                                                imageData.size());
+        image->setMetadata(*sourceImage);
+
+        Exiv2::ExifData &exifData = image->exifData();
+        Exiv2::ExifKey orientationKey("Exif.Image.Orientation");
+        if (resetOrientation && exifData.findKey(orientationKey) != exifData.end()) {
+            exifData[orientationKey.key()] = (uint16_t) 1;
+        }
+        image->writeMetadata();
+
+        Exiv2::BasicIo &imageIo = image->io();
+        if (imageIo.open() != 0) {
+            return false;
+        }
+        Exiv2::DataBuf data = imageIo.read(imageIo.size());
+        imageIo.close();
+        if (data.size_ <= 0) {
+            return false;
+        }
+        imageData = QByteArray((const char *) data.pData_, data.size_);
+    }
+    catch (Exiv2::Error &error) {
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageSaver::writeFile(const QString &fileName, const QByteArray &imageData, QString &errorString) {
+    QSaveFile saveFile(fileName);
+    if (!saveFile.open(QIODevice::WriteOnly) || saveFile.write(imageData) != imageData.size() || !saveFile.commit()) {
+        errorString = saveFile.errorString();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_SAVER_H
+#define IMAGE_SAVER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QImage>
+#include <QString>
+#include <QByteArray>
+#include <QRect>
+#include "ImageProcessor.h"
+
+/*
+ * Encodes and writes images on a worker thread, copying the metadata of the source
+ * file along. The encoded file is completed in memory and written through a
+ * temporary file that replaces the target in one rename, so an interrupted save
+ * never leaves a truncated image behind. Saves run one at a time in request order.
+ * A JPEG only rotated, flipped or cropped is transformed losslessly instead of re-encoded.
+ */
+class ImageSaver : public QObject {
+Q_OBJECT
+
+public:
+    struct Request {
+        QImage image;
+        QString sourceFileName;
+        QString fileName;
+        /* Taken from the file name suffix when empty */
+        QByteArray format;
+        int quality;
+        /* Set the Exif orientation of the copied metadata to upright */
+        bool resetOrientation;
+        /* Nonzero when the source JPEG is only oriented and cropped, the image is then a fallback */
+        long losslessOrientation;
+        QRect losslessCrop;
+    };
+
+    ImageSaver(QObject *parent);
+
+    ~ImageSaver();
+
+    void save(const Request &request);
+
+    bool isSaving();
+
+    /* Marks the request lossless when the parameters only orient and crop an image of this size */
+    static void setLosslessTransform(Request &request, const QSize &imageSize,
+                                     const ImageProcessor::Parameters &parameters);
+
+    /* Blocking, errorString is set on failure */
+    static bool saveImage(const Request &request, QString &errorString, bool &metadataSaved);
+
+    /* Blocking, losslessly turns a JPEG upright and resets its Exif orientation */
+    static bool normalizeOrientation(const QString &fileName, QString &errorString);
+
+signals:
+
+    /* errorString is null when the image was saved */
+    void imageSaved(QString sourceFileName, QString fileName, QString errorString, bool metadataSaved);
+
+private slots:
+
+    void onImageSaved(QString sourceFileName, QString fileName, QString errorString, bool metadataSaved);
+
+private:
+    QThreadPool threadPool;
+    int pendingSaves;
+
+    static bool copyMetadata(const QString &sourceFileName, QByteArray &imageData, bool resetOrientation);
+
+    static bool writeFile(const QString &fileName, const QByteArray &imageData, QString &errorString);
+};
+
+#endif // IMAGE_SAVER_H
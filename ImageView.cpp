@@ -0,0 +1,95 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageView.h"
+#include "ImageProcessor.h"
+
+ImageView::ImageView(QWidget *parent) : QWidget(parent) {
+    mirrorLayout = 0;
+}
+
+void ImageView::setImage(const QImage &image) {
+    this->image = image;
+    scaledPixmap = QPixmap();
+    update();
+}
+
+void ImageView::clear() {
+    image = QImage();
+    scaledPixmap = QPixmap();
+    update();
+}
+
+bool ImageView::hasImage() const {
+    return !image.isNull();
+}
+
+QSize ImageView::getImageSize() const {
+    return image.size();
+}
+
+void ImageView::setMirrorLayout(int mirrorLayout) {
+    this->mirrorLayout = mirrorLayout;
+    update();
+}
+
+void ImageView::paintEvent(QPaintEvent *event) {
+    QSize grid = ImageProcessor::getMirrorGrid(mirrorLayout);
+    QSize cellSize(width() / grid.width(), height() / grid.height());
+    if (image.isNull() || cellSize.isEmpty()) {
+        return;
+    }
+
+    QPainter painter(this);
+    for (int row = 0; row < grid.height(); ++row) {
+        for (int column = 0; column < grid.width(); ++column) {
+            QTransform cellTransform = ImageProcessor::getMirrorCellTransform(column, row, cellSize);
+            QRect exposedRect = event->rect() & cellTransform.mapRect(QRect(QPoint(0, 0), cellSize));
+            if (exposedRect.isEmpty()) {
+                continue;
+            }
+
+            painter.setTransform(cellTransform);
+            paintCell(painter, cellSize, cellTransform.inverted().mapRect(exposedRect));
+        }
+    }
+}
+
+/* exposedRect is in the coordinates of the cell */
+void ImageView::paintCell(QPainter &painter, const QSize &cellSize, const QRect &exposedRect) {
+    if (cellSize == image.size()) {
+        painter.drawImage(exposedRect, image, exposedRect);
+        return;
+    }
+
+    if ((qint64) cellSize.width() * cellSize.height() <= IMAGE_VIEW_MAX_CACHED_PIXELS) {
+        if (scaledPixmap.size() != cellSize) {
+            scaledPixmap = QPixmap::fromImage(image.scaled(cellSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        }
+        painter.drawPixmap(exposedRect, scaledPixmap, exposedRect);
+        return;
+    }
+
+    scaledPixmap = QPixmap();
+    qreal scaleX = (qreal) image.width() / cellSize.width();
+    qreal scaleY = (qreal) image.height() / cellSize.height();
+    QRectF sourceRect(exposedRect.x() * scaleX, exposedRect.y() * scaleY,
+                      exposedRect.width() * scaleX, exposedRect.height() * scaleY);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(QRectF(exposedRect), image, sourceRect);
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_VIEW_H
+#define IMAGE_VIEW_H
+
+#include <QWidget>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPixmap>
+
+#define IMAGE_VIEW_MAX_CACHED_PIXELS (16 * 1024 * 1024)
+
+/*
+ * Shows an image scaled to the size of the widget. One smoothly scaled copy is kept for the
+ * current size, so panning and repaints under overlays only copy the exposed area. When
+ * zoomed in so far that the copy would be too large, only the exposed area is resampled.
+ * Mirror layouts are drawn as flipped copies of the one image into the cells of the widget.
+ */
+class ImageView : public QWidget {
+Q_OBJECT
+
+public:
+    ImageView(QWidget *parent = nullptr);
+
+    void setImage(const QImage &image);
+
+    void clear();
+
+    bool hasImage() const;
+
+    QSize getImageSize() const;
+
+    void setMirrorLayout(int mirrorLayout);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    QImage image;
+    QPixmap scaledPixmap;
+    int mirrorLayout;
+
+    void paintCell(QPainter &painter, const QSize &cellSize, const QRect &exposedRect);
+};
+
+#endif // IMAGE_VIEW_H
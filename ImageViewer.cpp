@@ -21,20 +21,37 @@
 #include "MessageBox.h"
 
 #define CLIPBOARD_IMAGE_NAME "clipboard.png"
-#define ROUND(x) ((int) ((x) + 0.5))
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define PREVIEW_REFRESH_DELAY 400
 
-ImageViewer::ImageViewer(QWidget *parent, MetadataCache *metadataCache) : QWidget(parent) {
+ImageViewer::ImageViewer(QWidget *parent, MetadataCache *metadataCache, ImageCache *imageCache) : QWidget(parent) {
     this->phototonic = (Phototonic *) parent;
     this->metadataCache = metadataCache;
+    this->imageCache = imageCache;
     cursorIsHidden = false;
     moveImageLocked = false;
     mirrorLayout = LayNone;
-    imageLabel = new QLabel;
-    imageLabel->setScaledContents(true);
+    imageView = new ImageView;
+    imageWidget = imageView;
+    tiledImageView = new TiledImageView(this);
+    tiledImageView->hide();
     isAnimation = false;
-    animation = nullptr;
+    animationPlayer = nullptr;
+    previewScale = 1.0;
+    fullImageLoading = false;
+    proxyImageKey = 0;
+    proxyScale = 1.0;
+    previewRefreshTimer = new QTimer(this);
+    previewRefreshTimer->setSingleShot(true);
+    previewRefreshTimer->setInterval(PREVIEW_REFRESH_DELAY);
+    connect(previewRefreshTimer, SIGNAL(timeout()), this, SLOT(finishPreview()));
+    imagePrefetcher = new ImagePrefetcher(this, imageCache);
+    connect(imagePrefetcher, SIGNAL(fullImageDecoded(QString, QImage)),
+            this, SLOT(onFullImageDecoded(QString, QImage)));
+    imageLoader = new ImageLoader(this, imageCache, imagePrefetcher);
+    connect(imageLoader, SIGNAL(imageLoaded()), this, SLOT(onImageLoaded()));
+    imageSaver = new ImageSaver(this);
+    connect(imageSaver, SIGNAL(imageSaved(QString, QString, QString, bool)),
+            this, SLOT(onImageSaved(QString, QString, QString, bool)));
 
     scrollArea = new QScrollArea;
     scrollArea->setContentsMargins(0, 0, 0, 0);
@@ -44,7 +61,7 @@ ImageViewer::ImageViewer(QWidget *parent, MetadataCache *metadataCache) : QWidge
     scrollArea->verticalScrollBar()->blockSignals(true);
     scrollArea->horizontalScrollBar()->blockSignals(true);
     scrollArea->setFrameStyle(0);
-    scrollArea->setWidget(imageLabel);
+    scrollArea->setWidget(imageView);
     scrollArea->setWidgetResizable(true);
     setBackgroundColor();
 
@@ -72,6 +89,13 @@ ImageViewer::ImageViewer(QWidget *parent, MetadataCache *metadataCache) : QWidge
     feedbackEffect->setOpacity(0.5);
     feedbackLabel->setGraphicsEffect(feedbackEffect);
 
+    /* Busy indicator while saves are written in the background */
+    savingProgressBar = new QProgressBar(this);
+    savingProgressBar->setRange(0, 0);
+    savingProgressBar->setTextVisible(false);
+    savingProgressBar->setFixedSize(120, 10);
+    savingProgressBar->setVisible(false);
+
     mouseMovementTimer = new QTimer(this);
     connect(mouseMovementTimer, SIGNAL(timeout()), this, SLOT(monitorCursorState()));
 
@@ -112,14 +136,24 @@ static inline int calcZoom(int size) {
 
 void ImageViewer::resizeImage() {
     static bool busy = false;
-    if (busy || (!imageLabel->pixmap() && !animation)) {
+    if (busy || (!imageView->hasImage() && !animationPlayer && !tiledImageView->hasImage())) {
         return;
     }
     busy = true;
 
     int imageViewWidth = this->size().width();
     int imageViewHeight = this->size().height();
-    QSize imageSize = isAnimation ? animation->currentPixmap().size() : imageLabel->pixmap()->size();
+    QSize imageSize;
+    if (isAnimation) {
+        imageSize = animationPlayer->getImageSize();
+    } else if (tiledImageView->hasImage()) {
+        imageSize = tiledImageView->getImageSize();
+    } else {
+        /* A preview or a proxy is laid out at the size of the full resolution image */
+        imageSize = imageView->getImageSize() * previewScale * proxyScale;
+    }
+    QSize mirrorGrid = ImageProcessor::getMirrorGrid(mirrorLayout);
+    imageSize = QSize(imageSize.width() * mirrorGrid.width(), imageSize.height() * mirrorGrid.height());
 
     if (tempDisableResize) {
         imageSize.scale(imageSize.width(), imageSize.height(), Qt::KeepAspectRatio);
@@ -223,8 +257,25 @@ void ImageViewer::resizeImage() {
         }
     }
 
-    imageLabel->setFixedSize(imageSize);
-    imageLabel->adjustSize();
+    /* Zoomed in past the resolution of the preview */
+    QSize viewSize = imageView->getImageSize();
+    if (previewScale > 1.0 && !imageLoader->isLoading()
+        && (imageSize.width() > viewSize.width() * mirrorGrid.width()
+            || imageSize.height() > viewSize.height() * mirrorGrid.height())) {
+        imagePrefetcher->setFullImage(viewerImageFullPath);
+    }
+
+    /* Whole cells, so that the copies of a mirror layout meet without a seam */
+    imageSize = QSize(imageSize.width() / mirrorGrid.width() * mirrorGrid.width(),
+                      imageSize.height() / mirrorGrid.height() * mirrorGrid.height());
+
+    if (isAnimation) {
+        animationPlayer->setDisplaySize(QSize(imageSize.width() / mirrorGrid.width(),
+                                              imageSize.height() / mirrorGrid.height()));
+    }
+
+    imageWidget->setFixedSize(imageSize);
+    imageWidget->adjustSize();
     centerImage(imageSize);
     busy = false;
 }
@@ -232,6 +283,7 @@ void ImageViewer::resizeImage() {
 void ImageViewer::resizeEvent(QResizeEvent *event) {
     QWidget::resizeEvent(event);
     resizeImage();
+    placeSavingProgressBar();
 }
 
 void ImageViewer::showEvent(QShowEvent *event) {
@@ -243,336 +295,109 @@ void ImageViewer::centerImage(QSize &imgSize) {
     int newX = (this->size().width() - imgSize.width()) / 2;
     int newY = (this->size().height() - imgSize.height()) / 2;
 
-    if (newX != imageLabel->pos().x() || newY != imageLabel->pos().y()) {
-        imageLabel->move(newX, newY);
+    if (newX != imageWidget->pos().x() || newY != imageWidget->pos().y()) {
+        imageWidget->move(newX, newY);
     }
 }
 
 void ImageViewer::rotateByExifRotation(QImage &image, QString &imageFullPath) {
-    QTransform trans;
-    long orientation = metadataCache->getImageOrientation(imageFullPath);
-
-    switch (orientation) {
-        case 1:
-            break;
-        case 2:
-            image = image.mirrored(true, false);
-            break;
-        case 3:
-            trans.rotate(180);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        case 4:
-            image = image.mirrored(false, true);
-            break;
-        case 5:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            image = image.mirrored(true, false);
-            break;
-        case 6:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        case 7:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            image = image.mirrored(false, true);
-            break;
-        case 8:
-            trans.rotate(270);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        default:
-            break;
-    }
+    ImageProcessor::rotateByExifOrientation(image, metadataCache->getImageOrientation(imageFullPath));
 }
 
-void ImageViewer::transform() {
-    if (Settings::exifRotationEnabled) {
-        rotateByExifRotation(viewerImage, viewerImageFullPath);
-    }
-
-    if (Settings::rotation) {
-        QTransform trans;
-        trans.rotate(Settings::rotation);
-        viewerImage = viewerImage.transformed(trans, Qt::SmoothTransformation);
-    }
-
-    if (Settings::flipH || Settings::flipV) {
-        viewerImage = viewerImage.mirrored(Settings::flipH, Settings::flipV);
-    }
-
-    int cropLeftPercentPixels = 0, cropTopPercentPixels = 0, cropWidthPercentPixels = 0, cropHeightPercentPixels = 0;
-    bool croppingOn = false;
-    if (Settings::cropLeftPercent || Settings::cropTopPercent
-        || Settings::cropWidthPercent || Settings::cropHeightPercent) {
-        croppingOn = true;
-        cropLeftPercentPixels = (viewerImage.width() * Settings::cropLeftPercent) / 100;
-        cropTopPercentPixels = (viewerImage.height() * Settings::cropTopPercent) / 100;
-        cropWidthPercentPixels = (viewerImage.width() * Settings::cropWidthPercent) / 100;
-        cropHeightPercentPixels = (viewerImage.height() * Settings::cropHeightPercent) / 100;
-    }
-
-    if (Settings::cropLeft || Settings::cropTop || Settings::cropWidth || Settings::cropHeight) {
-        viewerImage = viewerImage.copy(
-                Settings::cropLeft + cropLeftPercentPixels,
-                Settings::cropTop + cropTopPercentPixels,
-                viewerImage.width() - Settings::cropLeft - Settings::cropWidth - cropLeftPercentPixels -
-                cropWidthPercentPixels,
-                viewerImage.height() - Settings::cropTop - Settings::cropHeight - cropTopPercentPixels -
-                cropHeightPercentPixels);
-    } else {
-        if (croppingOn) {
-            viewerImage = viewerImage.copy(
-                    cropLeftPercentPixels,
-                    cropTopPercentPixels,
-                    viewerImage.width() - cropLeftPercentPixels - cropWidthPercentPixels,
-                    viewerImage.height() - cropTopPercentPixels - cropHeightPercentPixels);
-        }
-    }
-}
-
-void ImageViewer::mirror() {
-    switch (mirrorLayout) {
-        case LayDual: {
-            mirrorImage = QImage(viewerImage.width() * 2, viewerImage.height(),
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
-            break;
-        }
-
-        case LayTriple: {
-            mirrorImage = QImage(viewerImage.width() * 3, viewerImage.height(),
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
-            painter.drawImage(viewerImage.width() * 2, 0, viewerImage.mirrored(false, false));
-            break;
-        }
-
-        case LayQuad: {
-            mirrorImage = QImage(viewerImage.width() * 2, viewerImage.height() * 2,
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
-            painter.drawImage(0, viewerImage.height(), viewerImage.mirrored(false, true));
-            painter.drawImage(viewerImage.width(), viewerImage.height(),
-                              viewerImage.mirrored(true, true));
-            break;
-        }
-
-        case LayVDual: {
-            mirrorImage = QImage(viewerImage.width(), viewerImage.height() * 2,
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(0, viewerImage.height(), viewerImage.mirrored(false, true));
-            break;
-        }
-    }
-
-    viewerImage = mirrorImage;
+ImageProcessor::Parameters ImageViewer::getProcessingParameters() {
+    long orientation = Settings::exifRotationEnabled ? metadataCache->getImageOrientation(viewerImageFullPath) : 0;
+    return ImageProcessor::getParameters(orientation);
 }
 
-static inline int bound0To255(int val) {
-    return ((val > 255) ? 255 : (val < 0) ? 0 : val);
+/* Pixel sizes are given in full resolution pixels */
+ImageProcessor::Parameters ImageViewer::getScaledProcessingParameters(qreal scale) {
+    ImageProcessor::Parameters parameters = getProcessingParameters();
+    parameters.scaledWidth = qRound(parameters.scaledWidth / scale);
+    parameters.scaledHeight = qRound(parameters.scaledHeight / scale);
+    parameters.cropLeft = qRound(parameters.cropLeft / scale);
+    parameters.cropTop = qRound(parameters.cropTop / scale);
+    parameters.cropWidth = qRound(parameters.cropWidth / scale);
+    parameters.cropHeight = qRound(parameters.cropHeight / scale);
+    return parameters;
 }
 
-static inline int hslValue(double n1, double n2, double hue) {
-    double value;
-
-    if (hue > 255) {
-        hue -= 255;
-    } else if (hue < 0) {
-        hue += 255;
-    }
-
-    if (hue < 42.5) {
-        value = n1 + (n2 - n1) * (hue / 42.5);
-    } else if (hue < 127.5) {
-        value = n2;
-    } else if (hue < 170) {
-        value = n1 + (n2 - n1) * ((170 - hue) / 42.5);
-    } else {
-        value = n1;
-    }
-
-    return ROUND(value * 255.0);
+void ImageViewer::setMirrorLayout(int mirrorLayout) {
+    this->mirrorLayout = mirrorLayout;
+    imageView->setMirrorLayout(mirrorLayout);
+    tiledImageView->setMirrorLayout(mirrorLayout);
+    resizeImage();
 }
 
-void rgbToHsl(int r, int g, int b, unsigned char *hue, unsigned char *sat, unsigned char *light) {
-    double h, s, l;
-    int min, max;
-    int delta;
-
-    if (r > g) {
-        max = MAX(r, b);
-        min = MIN(g, b);
-    } else {
-        max = MAX(g, b);
-        min = MIN(r, b);
-    }
-
-    l = (max + min) / 2.0;
-
-    if (max == min) {
-        s = 0.0;
-        h = 0.0;
-    } else {
-        delta = (max - min);
-
-        if (l < 128) {
-            s = 255 * (double) delta / (double) (max + min);
-        } else {
-            s = 255 * (double) delta / (double) (511 - max - min);
-        }
-
-        if (r == max) {
-            h = (g - b) / (double) delta;
-        } else if (g == max) {
-            h = 2 + (b - r) / (double) delta;
-        } else {
-            h = 4 + (r - g) / (double) delta;
-        }
-
-        h = h * 42.5;
-        if (h < 0) {
-            h += 255;
-        } else if (h > 255) {
-            h -= 255;
-        }
+QImage ImageViewer::getOutputImage() {
+    QImage outputImage = viewerImage;
+    if (mirrorLayout) {
+        ImageProcessor::mirror(outputImage, mirrorLayout);
     }
-
-    *hue = ROUND(h);
-    *sat = ROUND(s);
-    *light = ROUND(l);
+    return outputImage;
 }
 
-void hslToRgb(double h, double s, double l,
-              unsigned char *red, unsigned char *green, unsigned char *blue) {
-    if (s == 0) {
-        /* achromatic case */
-        *red = l;
-        *green = l;
-        *blue = l;
-    } else {
-        double m1, m2;
-
-        if (l < 128)
-            m2 = (l * (255 + s)) / 65025.0;
-        else
-            m2 = (l + s - (l * s) / 255.0) / 255.0;
-
-        m1 = (l / 127.5) - m2;
-
-        /* chromatic case */
-        *red = hslValue(m1, m2, h + 85);
-        *green = hslValue(m1, m2, h);
-        *blue = hslValue(m1, m2, h - 85);
+void ImageViewer::refresh() {
+    previewRefreshTimer->stop();
+    if (deferUntilLoaded("refresh", [this]() { refresh(); })) {
+        return;
     }
-}
 
-void ImageViewer::colorize() {
-    int y, x;
-    unsigned char hr, hg, hb;
-    int r, g, b;
-    QRgb *line;
-    unsigned char h, s, l;
-    static unsigned char contrastTransform[256];
-    static unsigned char brightTransform[256];
-    bool hasAlpha = viewerImage.hasAlphaChannel();
-
-    if (viewerImage.colorCount()) {
-        viewerImage = viewerImage.convertToFormat(QImage::Format_RGB32);
+    proxyScale = 1.0;
+    if (isAnimation) {
+        return;
     }
 
-    int i;
-    float contrast = ((float) Settings::contrastVal / 100.0);
-    float brightness = ((float) Settings::brightVal / 100.0);
-
-    for (i = 0; i < 256; ++i) {
-        if (i < (int) (128.0f + 128.0f * tan(contrast)) && i > (int) (128.0f - 128.0f * tan(contrast))) {
-            contrastTransform[i] = (i - 128) / tan(contrast) + 128;
-        } else if (i >= (int) (128.0f + 128.0f * tan(contrast))) {
-            contrastTransform[i] = 255;
+    ImageProcessor::Parameters parameters = getProcessingParameters();
+    if (tiledImageView->hasImage()) {
+        /* Orientation, quarter turns, flips, crops and colors are drawn from the tiles, scaling needs the whole image */
+        if (TiledImage::isTileable(fullImageSize, parameters)) {
+            tiledImageView->setParameters(parameters);
+            resizeImage();
         } else {
-            contrastTransform[i] = 0;
+            loadFullImage();
         }
+        return;
     }
 
-    for (i = 0; i < 256; ++i) {
-        brightTransform[i] = MIN(255, (int) ((255.0 * pow(i / 255.0, 1.0 / brightness)) + 0.5));
-    }
-
-    for (y = 0; y < viewerImage.height(); ++y) {
-
-        line = (QRgb *) viewerImage.scanLine(y);
-        for (x = 0; x < viewerImage.width(); ++x) {
-            r = Settings::rNegateEnabled ? bound0To255(255 - qRed(line[x])) : qRed(line[x]);
-            g = Settings::gNegateEnabled ? bound0To255(255 - qGreen(line[x])) : qGreen(line[x]);
-            b = Settings::bNegateEnabled ? bound0To255(255 - qBlue(line[x])) : qBlue(line[x]);
-
-            r = bound0To255((r * (Settings::redVal + 100)) / 100);
-            g = bound0To255((g * (Settings::greenVal + 100)) / 100);
-            b = bound0To255((b * (Settings::blueVal + 100)) / 100);
-
-            r = bound0To255(brightTransform[r]);
-            g = bound0To255(brightTransform[g]);
-            b = bound0To255(brightTransform[b]);
-
-            r = bound0To255(contrastTransform[r]);
-            g = bound0To255(contrastTransform[g]);
-            b = bound0To255(contrastTransform[b]);
-
-            rgbToHsl(r, g, b, &h, &s, &l);
-            h = Settings::colorizeEnabled ? Settings::hueVal : h + Settings::hueVal;
-            s = bound0To255(((s * Settings::saturationVal) / 100));
-            l = bound0To255(((l * Settings::lightnessVal) / 100));
-            hslToRgb(h, s, l, &hr, &hg, &hb);
-
-            r = Settings::hueRedChannel ? hr : qRed(line[x]);
-            g = Settings::hueGreenChannel ? hg : qGreen(line[x]);
-            b = Settings::hueBlueChannel ? hb : qBlue(line[x]);
+    /* A preview is edited as it is, the full image is only loaded for saving, copying or zooming in */
+    viewerImage = ImageProcessor::process(origImage, getScaledProcessingParameters(previewScale));
+    imageView->setImage(viewerImage);
+    resizeImage();
+}
 
-            if (hasAlpha) {
-                line[x] = qRgba(r, g, b, qAlpha(line[x]));
-            } else {
-                line[x] = qRgb(r, g, b);
-            }
-        }
+void ImageViewer::refreshPreview() {
+    if (deferUntilLoaded("refreshPreview", [this]() { refreshPreview(); })) {
+        return;
     }
-}
 
-void ImageViewer::refresh() {
-    if (isAnimation) {
+    if (isAnimation || tiledImageView->hasImage() || origImage.isNull()) {
+        refresh();
         return;
     }
 
-    if (Settings::scaledWidth) {
-        viewerImage = origImage.scaled(Settings::scaledWidth, Settings::scaledHeight,
-                                       Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QSize previewSize = getPreviewSize();
+    if (origImage.width() > previewSize.width() || origImage.height() > previewSize.height()) {
+        if (proxyImage.isNull() || proxyImageKey != origImage.cacheKey()) {
+            proxyImage = origImage.scaled(previewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            proxyImageKey = origImage.cacheKey();
+        }
+        proxyScale = (qreal) origImage.width() / proxyImage.width();
     } else {
-        viewerImage = origImage;
+        proxyImage = QImage();
+        proxyScale = 1.0;
     }
 
-    transform();
-
-    if (Settings::colorsActive || Settings::keepTransform) {
-        colorize();
-    }
+    ImageProcessor::Parameters parameters = getScaledProcessingParameters(previewScale * proxyScale);
+    viewerImage = ImageProcessor::process(proxyScale > 1.0 ? proxyImage : origImage, parameters);
+    imageView->setImage(viewerImage);
+    resizeImage();
+    previewRefreshTimer->start();
+}
 
-    if (mirrorLayout) {
-        mirror();
+void ImageViewer::finishPreview() {
+    if (previewRefreshTimer->isActive() || proxyScale > 1.0) {
+        refresh();
     }
-
-    viewerPixmap = QPixmap::fromImage(viewerImage);
-    imageLabel->setPixmap(viewerPixmap);
-    resizeImage();
 }
 
 QImage createImageWithOverlay(const QImage &baseImage, const QImage &overlayImage, int x, int y) {
@@ -597,7 +422,11 @@ QImage createImageWithOverlay(const QImage &baseImage, const QImage &overlayImag
 }
 
 void ImageViewer::reload() {
-    isAnimation = false;
+    previewRefreshTimer->stop();
+    imagePrefetcher->setFullImage(QString());
+    imageLoader->cancel();
+    pendingActions.clear();
+    fullImageLoading = false;
     if (Settings::showImageName) {
         if (viewerImageFullPath.left(1) == ":") {
             setInfo("No Image");
@@ -619,54 +448,213 @@ void ImageViewer::reload() {
     if (newImage || viewerImageFullPath.isEmpty()) {
         newImage = true;
         viewerImageFullPath = CLIPBOARD_IMAGE_NAME;
+        showImageView();
         origImage.load(":/images/no_image.png");
         viewerImage = origImage;
-        viewerPixmap = QPixmap::fromImage(viewerImage);
-        imageLabel->setPixmap(viewerPixmap);
+        imageView->setImage(viewerImage);
         pasteImage();
         return;
     }
 
-    QImageReader imageReader(viewerImageFullPath);
-    if (Settings::enableAnimations && imageReader.supportsAnimation()) {
-        if (animation) {
-            delete animation;
-        }
-        animation = new QMovie(viewerImageFullPath);
+    /* Only the header, the size is what edit dialogs opened during the load work with */
+    fullImageSize = QImageReader(viewerImageFullPath).size();
 
-        if (animation->frameCount() > 1) {
-            isAnimation = true;
-            imageLabel->setMovie(animation);
-            animation->start();
-            resizeImage();
-            return;
-        }
+    /* The current image stays on screen until the loader is done with this one */
+    QSize previewSize = getPreviewSize();
+    imagePrefetcher->setPreviewSize(previewSize);
+    imageLoader->load(viewerImageFullPath, previewSize, getProcessingParameters(), Settings::enableAnimations, true);
+}
+
+void ImageViewer::startAnimation() {
+    showImageView();
+    isAnimation = true;
+    animationPlayer = new AnimationPlayer(this, viewerImageFullPath);
+    connect(animationPlayer, SIGNAL(frameChanged(QImage)), this, SLOT(onAnimationFrameChanged(QImage)));
+
+    /* Laid out first, so that the first frames are already decoded at the display size */
+    resizeImage();
+    animationPlayer->start();
+}
+
+void ImageViewer::onImageLoaded() {
+    ImageLoader::Result result;
+    if (!imageLoader->takeResult(result)) {
+        return;
     }
 
-    if (imageReader.size().isValid() && imageReader.read(&origImage)) {
-        viewerImage = origImage;
-        transform();
-        if (Settings::colorsActive || Settings::keepTransform) {
-            colorize();
-        }
-        if (mirrorLayout) {
-            mirror();
-        }
-        viewerPixmap = QPixmap::fromImage(viewerImage);
+    /* The preview or tiles on screen stay, the actions waiting for the full image can't run */
+    bool fullImageLoaded = fullImageLoading;
+    fullImageLoading = false;
+    if (fullImageLoaded && result.origImage.isNull()) {
+        pendingActions.clear();
+        setFeedback(tr("Failed to load the full image: ") + result.errorString);
+        return;
+    }
+
+    fullImageSize = result.fullImageSize;
+    if (result.animated) {
+        startAnimation();
+        runPendingActions();
+        return;
+    }
+
+    if (result.tiled) {
+        showTiledImage(result);
+        runPendingActions();
+        return;
+    }
+
+    showImageView();
+    fullImageSize = result.fullImageSize;
+    if (!result.origImage.isNull()) {
+        origImage = result.origImage;
+        viewerImage = result.viewerImage;
+        previewScale = result.previewScale;
     } else {
-        viewerPixmap = QIcon::fromTheme("image-missing",
-                                        QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE, BAD_IMAGE_SIZE);
-        setInfo(imageReader.errorString());
+        viewerImage = QIcon::fromTheme("image-missing",
+                                       QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE,
+                                                                                 BAD_IMAGE_SIZE).toImage();
+        setInfo(result.errorString);
     }
 
-    imageLabel->setPixmap(viewerPixmap);
+    imageView->setImage(viewerImage);
     resizeImage();
+
+    /* From the processed image, so the icon shows the current edits */
     if (Settings::setWindowIcon) {
-        phototonic->setWindowIcon(viewerPixmap.scaled(WINDOW_ICON_SIZE, WINDOW_ICON_SIZE,
-                                                      Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        phototonic->setWindowIcon(QPixmap::fromImage(viewerImage.scaled(WINDOW_ICON_SIZE, WINDOW_ICON_SIZE,
+                                                                        Qt::KeepAspectRatio,
+                                                                        Qt::SmoothTransformation)));
+    }
+
+    runPendingActions();
+}
+
+bool ImageViewer::deferUntilFullImage(const QString &actionName, std::function<void()> action) {
+    if (deferUntilLoaded(actionName, action)) {
+        return true;
+    }
+
+    if (!isFullImageLoaded()) {
+        loadFullImage();
+        pendingActions.append(qMakePair(actionName, action));
+        return true;
+    }
+
+    if (proxyScale > 1.0) {
+        refresh();
+    }
+    return false;
+}
+
+bool ImageViewer::deferUntilLoaded(const QString &actionName, std::function<void()> action) {
+    if (imageLoader->isLoading()) {
+        /* Repeated requests, e.g. from a slider being dragged, run once */
+        for (int i = 0; i < pendingActions.size(); ++i) {
+            if (pendingActions.at(i).first == actionName) {
+                return true;
+            }
+        }
+        pendingActions.append(qMakePair(actionName, action));
+        return true;
+    }
+
+    /* Loaded, but the queued notification has not arrived yet */
+    onImageLoaded();
+    return false;
+}
+
+void ImageViewer::runPendingActions() {
+    QList<QPair<QString, std::function<void()> > > actions = pendingActions;
+    pendingActions.clear();
+    for (int i = 0; i < actions.size(); ++i) {
+        actions.at(i).second();
     }
 }
 
+void ImageViewer::showImageView() {
+    isAnimation = false;
+    if (animationPlayer) {
+        delete animationPlayer;
+        animationPlayer = nullptr;
+    }
+    previewScale = 1.0;
+    proxyScale = 1.0;
+    tiledImageView->clear();
+    setImageWidget(imageView);
+}
+
+void ImageViewer::onAnimationFrameChanged(const QImage &frame) {
+    imageView->setImage(frame);
+}
+
+void ImageViewer::setImageWidget(QWidget *widget) {
+    if (imageWidget == widget) {
+        return;
+    }
+
+    /* Take the current widget back first, the scroll area would delete it */
+    QWidget *previousWidget = scrollArea->takeWidget();
+    previousWidget->setParent(this);
+    previousWidget->hide();
+    scrollArea->setWidget(widget);
+    widget->show();
+    imageWidget = widget;
+}
+
+void ImageViewer::showTiledImage(const ImageLoader::Result &result) {
+    ImageProcessor::Parameters parameters = getProcessingParameters();
+    showImageView();
+    origImage = viewerImage = QImage();
+    imageView->clear();
+    tiledImageView->setImage(viewerImageFullPath, result.fullImageSize, result.sourceBaseImage, result.baseImage,
+                             parameters);
+    setImageWidget(tiledImageView);
+    resizeImage();
+
+    /* The base image already has the colors, the icon only needs the orientation and crop */
+    if (Settings::setWindowIcon) {
+        parameters.applyColors = false;
+        QImage iconImage = result.baseImage.scaled(WINDOW_ICON_SIZE * 4, WINDOW_ICON_SIZE * 4, Qt::KeepAspectRatio);
+        iconImage = ImageProcessor::process(iconImage, parameters);
+        phototonic->setWindowIcon(QPixmap::fromImage(iconImage.scaled(WINDOW_ICON_SIZE, WINDOW_ICON_SIZE,
+                                                                      Qt::KeepAspectRatio,
+                                                                      Qt::SmoothTransformation)));
+    }
+}
+
+QSize ImageViewer::getPreviewSize() {
+    /* Square, so that it still covers the screen when the image is shown rotated */
+    QRect screenRect = QApplication::desktop()->screenGeometry(this);
+    int side = qRound(qMax(screenRect.width(), screenRect.height()) * devicePixelRatioF());
+    return QSize(side, side);
+}
+
+bool ImageViewer::isFullImageLoaded() {
+    return !tiledImageView->hasImage() && previewScale == 1.0;
+}
+
+void ImageViewer::onFullImageDecoded(const QString &imageFileName, const QImage &image) {
+    if (previewScale == 1.0 || imageFileName != viewerImageFullPath || imageLoader->isLoading()) {
+        return;
+    }
+
+    origImage = image;
+    previewScale = 1.0;
+    refresh();
+}
+
+void ImageViewer::loadFullImage() {
+    if (isFullImageLoaded() || fullImageLoading) {
+        return;
+    }
+
+    /* Decoded by the loader with the current edits, the preview or tiles stay on screen until it is done */
+    setFeedback(tr("Loading full image..."));
+    fullImageLoading = true;
+    imageLoader->load(viewerImageFullPath, QSize(), getProcessingParameters(), false, false);
+}
+
 void ImageViewer::setInfo(QString infoString) {
     imageInfoLabel->setText(infoString);
     imageInfoLabel->adjustSize();
@@ -702,10 +690,11 @@ void ImageViewer::loadImage(QString imageFileName) {
 }
 
 void ImageViewer::clearImage() {
+    imageLoader->cancel();
+    showImageView();
     origImage.load(":/images/no_image.png");
     viewerImage = origImage;
-    viewerPixmap = QPixmap::fromImage(viewerImage);
-    imageLabel->setPixmap(viewerPixmap);
+    imageView->setImage(viewerImage);
 }
 
 void ImageViewer::monitorCursorState() {
@@ -747,6 +736,10 @@ void ImageViewer::mouseDoubleClickEvent(QMouseEvent *event) {
 void ImageViewer::mousePressEvent(QMouseEvent *event) {
     if (event->button() == Qt::LeftButton) {
         if (event->modifiers() == Qt::ControlModifier) {
+            /* Crop coordinates are taken in full resolution pixels, a loading image gets them once shown */
+            if (!imageLoader->isLoading() && (previewScale > 1.0 || proxyScale > 1.0)) {
+                refresh();
+            }
             cropOrigin = event->pos();
             if (!cropRubberBand) {
                 cropRubberBand = new CropRubberBand(this);
@@ -785,18 +778,34 @@ void ImageViewer::mouseReleaseEvent(QMouseEvent *event) {
 }
 
 void ImageViewer::cropToSelection() {
+    if (deferUntilLoaded("crop", [this]() { cropToSelection(); })) {
+        return;
+    }
+
     if (cropRubberBand && cropRubberBand->isVisible()) {
 
         QPoint bandTopLeft = mapToGlobal(cropRubberBand->geometry().topLeft());
         QPoint bandBottomRight = mapToGlobal(cropRubberBand->geometry().bottomRight());
 
-        bandTopLeft = imageLabel->mapFromGlobal(bandTopLeft);
-        bandBottomRight = imageLabel->mapFromGlobal(bandBottomRight);
-
-        double scaledX = imageLabel->rect().width();
-        double scaledY = imageLabel->rect().height();
-        scaledX = viewerPixmap.width() / scaledX;
-        scaledY = viewerPixmap.height() / scaledY;
+        bandTopLeft = imageWidget->mapFromGlobal(bandTopLeft);
+        bandBottomRight = imageWidget->mapFromGlobal(bandBottomRight);
+
+        /* Map the selection back from the copy of a mirror layout it was drawn in, which may be flipped */
+        QSize mirrorGrid = ImageProcessor::getMirrorGrid(mirrorLayout);
+        QSize cellSize(imageWidget->width() / mirrorGrid.width(), imageWidget->height() / mirrorGrid.height());
+        QRect bandRect(bandTopLeft, bandBottomRight);
+        int column = qBound(0, bandRect.center().x() / qMax(1, cellSize.width()), mirrorGrid.width() - 1);
+        int row = qBound(0, bandRect.center().y() / qMax(1, cellSize.height()), mirrorGrid.height() - 1);
+        QTransform cellTransform = ImageProcessor::getMirrorCellTransform(column, row, cellSize);
+        bandRect &= cellTransform.mapRect(QRect(QPoint(0, 0), cellSize));
+        bandRect = cellTransform.inverted().mapRect(QRectF(bandRect)).toAlignedRect() & QRect(QPoint(0, 0), cellSize);
+        bandTopLeft = bandRect.topLeft();
+        bandBottomRight = bandRect.bottomRight();
+
+        QSize pixmapSize = tiledImageView->hasImage() ? tiledImageView->getImageSize()
+                                                      : imageView->getImageSize() * previewScale * proxyScale;
+        double scaledX = (double) pixmapSize.width() / qMax(1, cellSize.width());
+        double scaledY = (double) pixmapSize.height() / qMax(1, cellSize.height());
 
         bandTopLeft.setX(int(bandTopLeft.x() * scaledX));
         bandTopLeft.setY(int(bandTopLeft.y() * scaledY));
@@ -805,8 +814,8 @@ void ImageViewer::cropToSelection() {
 
         int cropLeft = bandTopLeft.x();
         int cropTop = bandTopLeft.y();
-        int cropWidth = viewerPixmap.width() - bandBottomRight.x();
-        int cropHeight = viewerPixmap.height() - bandBottomRight.y();
+        int cropWidth = pixmapSize.width() - bandBottomRight.x();
+        int cropHeight = pixmapSize.height() - bandBottomRight.y();
 
         if (cropLeft > 0) {
             Settings::cropLeft += cropLeft;
@@ -834,8 +843,8 @@ void ImageViewer::setMouseMoveData(bool lockMove, int lMouseX, int lMouseY) {
     moveImageLocked = lockMove;
     mouseX = lMouseX;
     mouseY = lMouseY;
-    layoutX = imageLabel->pos().x();
-    layoutY = imageLabel->pos().y();
+    layoutX = imageWidget->pos().x();
+    layoutY = imageWidget->pos().y();
 }
 
 void ImageViewer::mouseMoveEvent(QMouseEvent *event) {
@@ -849,22 +858,22 @@ void ImageViewer::mouseMoveEvent(QMouseEvent *event) {
             int newY = layoutY + (event->pos().y() - mouseY);
             bool needToMove = false;
 
-            if (imageLabel->size().width() > size().width()) {
+            if (imageWidget->size().width() > size().width()) {
                 if (newX > 0) {
                     newX = 0;
-                } else if (newX < (size().width() - imageLabel->size().width())) {
-                    newX = (size().width() - imageLabel->size().width());
+                } else if (newX < (size().width() - imageWidget->size().width())) {
+                    newX = (size().width() - imageWidget->size().width());
                 }
                 needToMove = true;
             } else {
                 newX = layoutX;
             }
 
-            if (imageLabel->size().height() > size().height()) {
+            if (imageWidget->size().height() > size().height()) {
                 if (newY > 0) {
                     newY = 0;
-                } else if (newY < (size().height() - imageLabel->size().height())) {
-                    newY = (size().height() - imageLabel->size().height());
+                } else if (newY < (size().height() - imageWidget->size().height())) {
+                    newY = (size().height() - imageWidget->size().height());
                 }
                 needToMove = true;
             } else {
@@ -872,15 +881,15 @@ void ImageViewer::mouseMoveEvent(QMouseEvent *event) {
             }
 
             if (needToMove) {
-                imageLabel->move(newX, newY);
+                imageWidget->move(newX, newY);
             }
         }
     }
 }
 
 void ImageViewer::keyMoveEvent(int direction) {
-    int newX = layoutX = imageLabel->pos().x();
-    int newY = layoutY = imageLabel->pos().y();
+    int newX = layoutX = imageWidget->pos().x();
+    int newY = layoutY = imageWidget->pos().y();
     bool needToMove = false;
 
     switch (direction) {
@@ -898,22 +907,22 @@ void ImageViewer::keyMoveEvent(int direction) {
             break;
     }
 
-    if (imageLabel->size().width() > size().width()) {
+    if (imageWidget->size().width() > size().width()) {
         if (newX > 0) {
             newX = 0;
-        } else if (newX < (size().width() - imageLabel->size().width())) {
-            newX = (size().width() - imageLabel->size().width());
+        } else if (newX < (size().width() - imageWidget->size().width())) {
+            newX = (size().width() - imageWidget->size().width());
         }
         needToMove = true;
     } else {
         newX = layoutX;
     }
 
-    if (imageLabel->size().height() > size().height()) {
+    if (imageWidget->size().height() > size().height()) {
         if (newY > 0) {
             newY = 0;
-        } else if (newY < (size().height() - imageLabel->size().height())) {
-            newY = (size().height() - imageLabel->size().height());
+        } else if (newY < (size().height() - imageWidget->size().height())) {
+            newY = (size().height() - imageWidget->size().height());
         }
         needToMove = true;
     } else {
@@ -925,70 +934,36 @@ void ImageViewer::keyMoveEvent(int direction) {
 
         switch (direction) {
             case MoveLeft:
-                for (i = imageLabel->pos().x(); i <= newX; ++i)
-                    imageLabel->move(newX, newY);
+                for (i = imageWidget->pos().x(); i <= newX; ++i)
+                    imageWidget->move(newX, newY);
                 break;
             case MoveRight:
-                for (i = imageLabel->pos().x(); i >= newX; --i)
-                    imageLabel->move(newX, newY);
+                for (i = imageWidget->pos().x(); i >= newX; --i)
+                    imageWidget->move(newX, newY);
                 break;
             case MoveUp:
-                for (i = imageLabel->pos().y(); i <= newY; ++i)
-                    imageLabel->move(newX, newY);
+                for (i = imageWidget->pos().y(); i <= newY; ++i)
+                    imageWidget->move(newX, newY);
                 break;
             case MoveDown:
-                for (i = imageLabel->pos().y(); i >= newY; --i)
-                    imageLabel->move(newX, newY);
+                for (i = imageWidget->pos().y(); i >= newY; --i)
+                    imageWidget->move(newX, newY);
                 break;
         }
     }
 }
 
 void ImageViewer::saveImage() {
-    Exiv2::Image::AutoPtr image;
-    bool exifError = false;
-
     if (newImage) {
         saveImageAs();
         return;
     }
 
-    setFeedback(tr("Saving..."));
-
-    try {
-        image = Exiv2::ImageFactory::open(viewerImageFullPath.toStdString());
-        image->readMetadata();
-    }
-    catch (Exiv2::Error &error) {
-        exifError = true;
-    }
-
     QImageReader imageReader(viewerImageFullPath);
-    if (!viewerPixmap.save(viewerImageFullPath, imageReader.format().toUpper(), Settings::defaultSaveQuality)) {
-        MessageBox msgBox(this);
-        msgBox.critical(tr("Error"), tr("Failed to save image."));
-        return;
-    }
-
-    if (!exifError) {
-        try {
-            image->writeMetadata();
-        }
-        catch (Exiv2::Error &error) {
-            MessageBox msgBox(this);
-            msgBox.critical(tr("Error"), tr("Failed to save Exif metadata."));
-        }
-    }
-
-    reload();
-    setFeedback(tr("Image saved."));
+    saveOutputImage(viewerImageFullPath, imageReader.format());
 }
 
 void ImageViewer::saveImageAs() {
-    Exiv2::Image::AutoPtr exifImage;
-    Exiv2::Image::AutoPtr newExifImage;
-    bool exifError = false;
-
     setCursorHiding(false);
 
     QString fileName = QFileDialog::getSaveFileName(this,
@@ -998,36 +973,66 @@ void ImageViewer::saveImageAs() {
                                                     " (*.jpg *.jpeg *.png *.bmp *.tif *.tiff *.ppm *.pgm *.pbm *.xbm *.xpm *.cur *.ico *.icns *.wbmp *.webp)");
 
     if (!fileName.isEmpty()) {
-        try {
-            exifImage = Exiv2::ImageFactory::open(viewerImageFullPath.toStdString());
-            exifImage->readMetadata();
-        }
-        catch (Exiv2::Error &error) {
-            exifError = true;
-        }
+        saveOutputImage(fileName, QByteArray());
+    }
+    if (phototonic->isFullScreen()) {
+        setCursorHiding(true);
+    }
+}
+
+/* Encoding and the metadata copy run on the saver thread, the viewer stays responsive */
+void ImageViewer::saveOutputImage(const QString &fileName, const QByteArray &format) {
+    if (deferUntilFullImage("save " + fileName,
+                            [this, fileName, format]() { saveOutputImage(fileName, format); })) {
+        return;
+    }
+
+    ImageSaver::Request request;
+    request.image = getOutputImage();
+    request.sourceFileName = viewerImageFullPath;
+    request.fileName = fileName;
+    request.format = format;
+    request.quality = Settings::defaultSaveQuality;
+    request.resetOrientation = getProcessingParameters().exifOrientation > 1;
+    request.losslessOrientation = 0;
+    if (!newImage && !isAnimation && !mirrorLayout) {
+        ImageSaver::setLosslessTransform(request, fullImageSize, getProcessingParameters());
+    }
+    imageSaver->save(request);
+    setFeedback(tr("Saving..."));
+    placeSavingProgressBar();
+    savingProgressBar->setVisible(true);
+}
+
+void ImageViewer::placeSavingProgressBar() {
+    savingProgressBar->move(10, height() - savingProgressBar->height() - 10);
+}
+
+void ImageViewer::onImageSaved(QString sourceFileName, QString fileName, QString errorString, bool metadataSaved) {
+    savingProgressBar->setVisible(imageSaver->isSaving());
+
+    if (!errorString.isNull()) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("Failed to save image %1: %2").arg(fileName, errorString));
+        return;
+    }
 
+    /* The orientation may have been reset */
+    metadataCache->removeImage(fileName);
 
-        if (!viewerPixmap.save(fileName, 0, Settings::defaultSaveQuality)) {
+    /* Saved over the original, which is then shown again as it is now on disk */
+    if (fileName == sourceFileName) {
+        if (!metadataSaved) {
             MessageBox msgBox(this);
-            msgBox.critical(tr("Error"), tr("Failed to save image."));
-        } else {
-            if (!exifError) {
-                try {
-                    newExifImage = Exiv2::ImageFactory::open(fileName.toStdString());
-                    newExifImage->setMetadata(*exifImage);
-                    newExifImage->writeMetadata();
-                }
-                catch (Exiv2::Error &error) {
-                    exifError = true;
-                }
-            }
+            msgBox.critical(tr("Error"), tr("Failed to save Exif metadata."));
+        }
 
-            setFeedback(tr("Image saved."));
+        if (fileName == viewerImageFullPath && !newImage) {
+            reload();
         }
     }
-    if (phototonic->isFullScreen()) {
-        setCursorHiding(true);
-    }
+
+    setFeedback(tr("Image saved."));
 }
 
 void ImageViewer::contextMenuEvent(QContextMenuEvent *) {
@@ -1038,12 +1043,13 @@ void ImageViewer::contextMenuEvent(QContextMenuEvent *) {
     ImagePopUpMenu->exec(QCursor::pos());
 }
 
+/* While loading, origImage still belongs to the previous image */
 int ImageViewer::getImageWidthPreCropped() {
-    return origImage.width();
+    return isFullImageLoaded() && !imageLoader->isLoading() ? origImage.width() : fullImageSize.width();
 }
 
 int ImageViewer::getImageHeightPreCropped() {
-    return origImage.height();
+    return isFullImageLoaded() && !imageLoader->isLoading() ? origImage.height() : fullImageSize.height();
 }
 
 bool ImageViewer::isNewImage() {
@@ -1051,7 +1057,11 @@ bool ImageViewer::isNewImage() {
 }
 
 void ImageViewer::copyImage() {
-    QApplication::clipboard()->setImage(viewerImage);
+    if (deferUntilFullImage("copy", [this]() { copyImage(); })) {
+        return;
+    }
+
+    QApplication::clipboard()->setImage(getOutputImage());
 }
 
 void ImageViewer::pasteImage() {
@@ -1060,6 +1070,8 @@ void ImageViewer::pasteImage() {
     }
 
     if (!QApplication::clipboard()->image().isNull()) {
+        imageLoader->cancel();
+        showImageView();
         origImage = QApplication::clipboard()->image();
         refresh();
     }
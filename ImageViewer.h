@@ -19,11 +19,20 @@
 #ifndef IMAGE_VIEWER_H
 #define IMAGE_VIEWER_H
 
+#include <functional>
 #include <QGraphicsDropShadowEffect>
 #include <exiv2/exiv2.hpp>
 #include "Settings.h"
 #include "CropRubberband.h"
 #include "MetadataCache.h"
+#include "ImagePrefetcher.h"
+#include "ImageCache.h"
+#include "ImageView.h"
+#include "AnimationPlayer.h"
+#include "TiledImageView.h"
+#include "ImageLoader.h"
+#include "ImageSaver.h"
+#include "ImageProcessor.h"
 
 class Phototonic;
 
@@ -32,12 +41,13 @@ Q_OBJECT
 
 public:
     bool tempDisableResize;
-    int mirrorLayout;
     QString viewerImageFullPath;
     QMenu *ImagePopUpMenu;
     QScrollArea *scrollArea;
     QLabel *imageInfoLabel;
     CropRubberBand *cropRubberBand;
+    ImagePrefetcher *imagePrefetcher;
+    ImageCache *imageCache;
 
     enum ZoomMethods {
         Disable = 0,
@@ -62,7 +72,7 @@ public:
         MoveRight
     };
 
-    ImageViewer(QWidget *parent, MetadataCache *metadataCache);
+    ImageViewer(QWidget *parent, MetadataCache *metadataCache, ImageCache *imageCache);
 
     void loadImage(QString imageFileName);
 
@@ -74,6 +84,9 @@ public:
 
     void refresh();
 
+    /* Renders edits on a screen sized proxy, the full resolution image follows once they stop */
+    void refreshPreview();
+
     void reload();
 
     int getImageWidthPreCropped();
@@ -92,6 +105,8 @@ public:
 
     void setBackgroundColor();
 
+    void setMirrorLayout(int mirrorLayout);
+
 public slots:
 
     void monitorCursorState();
@@ -106,10 +121,20 @@ public slots:
 
     void cropToSelection();
 
+    void finishPreview();
+
 private slots:
 
     void unsetFeedback();
 
+    void onFullImageDecoded(const QString &imageFileName, const QImage &image);
+
+    void onImageLoaded();
+
+    void onAnimationFrameChanged(const QImage &frame);
+
+    void onImageSaved(QString sourceFileName, QString fileName, QString errorString, bool metadataSaved);
+
 protected:
     void resizeEvent(QResizeEvent *event);
 
@@ -127,13 +152,21 @@ protected:
 
 private:
     Phototonic *phototonic;
-    QLabel *imageLabel;
-    QPixmap viewerPixmap;
+    ImageView *imageView;
+    TiledImageView *tiledImageView;
+    QWidget *imageWidget;
+    int mirrorLayout;
     QImage origImage;
     QImage viewerImage;
-    QImage mirrorImage;
+    QSize fullImageSize;
+    qreal previewScale;
+    bool fullImageLoading;
+    QImage proxyImage;
+    qint64 proxyImageKey;
+    qreal proxyScale;
+    QTimer *previewRefreshTimer;
     QTimer *mouseMovementTimer;
-    QMovie *animation;
+    AnimationPlayer *animationPlayer;
     bool newImage;
     bool cursorIsHidden;
     bool moveImageLocked;
@@ -143,18 +176,51 @@ private:
     int layoutY;
     bool isAnimation;
     QLabel *feedbackLabel;
+    QProgressBar *savingProgressBar;
     QPoint cropOrigin;
     MetadataCache *metadataCache;
+    ImageLoader *imageLoader;
+    ImageSaver *imageSaver;
+    QList<QPair<QString, std::function<void()> > > pendingActions;
+
+    void saveOutputImage(const QString &fileName, const QByteArray &format);
+
+    void placeSavingProgressBar();
 
     void setMouseMoveData(bool lockMove, int lMouseX, int lMouseY);
 
     void centerImage(QSize &imgSize);
 
-    void transform();
+    ImageProcessor::Parameters getProcessingParameters();
+
+    /* For an image decoded at 1/scale of the full resolution */
+    ImageProcessor::Parameters getScaledProcessingParameters(qreal scale);
+
+    /* The image as saved and copied, with the mirror layout applied */
+    QImage getOutputImage();
+
+    /* Edits and saving apply to the image being loaded, not to the one still on screen,
+       so while it loads they are queued and run once it is shown */
+    bool deferUntilLoaded(const QString &actionName, std::function<void()> action);
+
+    /* Like deferUntilLoaded, and saving and copying also wait for the full resolution image */
+    bool deferUntilFullImage(const QString &actionName, std::function<void()> action);
+
+    void runPendingActions();
+
+    void startAnimation();
+
+    void showImageView();
+
+    void setImageWidget(QWidget *widget);
+
+    void showTiledImage(const ImageLoader::Result &result);
+
+    void loadFullImage();
 
-    void mirror();
+    bool isFullImageLoaded();
 
-    void colorize();
+    QSize getPreviewSize();
 };
 
 #endif // IMAGE_VIEWER_H
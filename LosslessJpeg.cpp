@@ -0,0 +1,293 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csetjmp>
+#include <jpeglib.h>
+#include "LosslessJpeg.h"
+
+struct JpegErrorManager {
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+/* Everything the libjpeg error handler may jump out of lives on the heap */
+struct JpegTransformState {
+    jpeg_decompress_struct source;
+    jpeg_compress_struct destination;
+    JpegErrorManager error;
+    unsigned char *outputBuffer;
+    unsigned long outputSize;
+};
+
+static void onJpegError(j_common_ptr cinfo) {
+    JpegErrorManager *error = (JpegErrorManager *) cinfo->err;
+    (*cinfo->err->format_message)(cinfo, error->message);
+    longjmp(error->jump, 1);
+}
+
+static void onJpegMessage(j_common_ptr) {
+}
+
+static inline bool isMarker(jpeg_saved_marker_ptr marker, int code, const char *identifier, unsigned int length) {
+    return marker->marker == code && marker->data_length >= length
+           && memcmp(marker->data, identifier, length) == 0;
+}
+
+/* Moves the blocks of every component and transforms the coefficients inside them */
+static void transformCoefficients(JpegTransformState *state, jvirt_barray_ptr *sourceArrays,
+                                  jvirt_barray_ptr *destinationArrays, const QRect &crop, int orientedWidth,
+                                  int orientedHeight, bool transpose, bool mirrorX, bool mirrorY) {
+    jpeg_decompress_struct &source = state->source;
+    jpeg_compress_struct &destination = state->destination;
+    int maxHorizontalFactor = 1;
+    int maxVerticalFactor = 1;
+    for (int component = 0; component < destination.num_components; ++component) {
+        maxHorizontalFactor = qMax(maxHorizontalFactor, destination.comp_info[component].h_samp_factor);
+        maxVerticalFactor = qMax(maxVerticalFactor, destination.comp_info[component].v_samp_factor);
+    }
+
+    for (int component = 0; component < destination.num_components; ++component) {
+        jpeg_component_info *sourceComponent = source.comp_info + component;
+        jpeg_component_info *destinationComponent = destination.comp_info + component;
+
+        /* Size of this component's blocks in image pixels, along the oriented axes */
+        int blockWidth = DCTSIZE * maxHorizontalFactor / destinationComponent->h_samp_factor;
+        int blockHeight = DCTSIZE * maxVerticalFactor / destinationComponent->v_samp_factor;
+        int firstColumn = mirrorX ? (orientedWidth - crop.x()) / blockWidth - 1 : crop.x() / blockWidth;
+        int firstRow = mirrorY ? (orientedHeight - crop.y()) / blockHeight - 1 : crop.y() / blockHeight;
+        int sourceWidth = sourceComponent->width_in_blocks;
+        int sourceHeight = sourceComponent->height_in_blocks;
+        int rowsPerPass = destinationComponent->v_samp_factor;
+        int destinationWidth = ((destinationComponent->width_in_blocks + destinationComponent->h_samp_factor - 1)
+                                / destinationComponent->h_samp_factor) * destinationComponent->h_samp_factor;
+        int destinationHeight = ((destinationComponent->height_in_blocks + rowsPerPass - 1) / rowsPerPass)
+                                * rowsPerPass;
+
+        for (int passRow = 0; passRow < destinationHeight; passRow += rowsPerPass) {
+            JBLOCKARRAY destinationRows = (*destination.mem->access_virt_barray)(
+                    (j_common_ptr) &destination, destinationArrays[component], passRow, rowsPerPass, TRUE);
+
+            for (int row = 0; row < rowsPerPass; ++row) {
+                int orientedRow = mirrorY ? firstRow - (passRow + row) : firstRow + passRow + row;
+                for (int column = 0; column < destinationWidth; ++column) {
+                    int orientedColumn = mirrorX ? firstColumn - column : firstColumn + column;
+                    int sourceColumn = transpose ? orientedRow : orientedColumn;
+                    int sourceRow = transpose ? orientedColumn : orientedRow;
+                    JCOEFPTR destinationBlock = destinationRows[row][column];
+
+                    /* Padding past the image edges */
+                    if (sourceColumn < 0 || sourceColumn >= sourceWidth || sourceRow < 0 || sourceRow >= sourceHeight) {
+                        memset(destinationBlock, 0, sizeof(JBLOCK));
+                        continue;
+                    }
+
+                    JBLOCKARRAY sourceRows = (*source.mem->access_virt_barray)(
+                            (j_common_ptr) &source, sourceArrays[component], sourceRow, 1, FALSE);
+                    JCOEFPTR sourceBlock = sourceRows[0][sourceColumn];
+
+                    /* Mirroring negates the odd frequencies along the mirrored axis */
+                    for (int v = 0; v < DCTSIZE; ++v) {
+                        for (int u = 0; u < DCTSIZE; ++u) {
+                            JCOEF coefficient = transpose ? sourceBlock[u * DCTSIZE + v] : sourceBlock[v * DCTSIZE + u];
+                            if ((mirrorX && (u & 1)) != (mirrorY && (v & 1))) {
+                                coefficient = -coefficient;
+                            }
+                            destinationBlock[v * DCTSIZE + u] = coefficient;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static bool runTransform(JpegTransformState *state, const QByteArray &jpegData, long orientation,
+                         const QRect &requestedCrop, bool trim, QString &errorString) {
+    jpeg_decompress_struct &source = state->source;
+    jpeg_compress_struct &destination = state->destination;
+
+    if (setjmp(state->error.jump)) {
+        errorString = QString::fromLocal8Bit(state->error.message);
+        return false;
+    }
+
+    jpeg_mem_src(&source, (unsigned char *) jpegData.constData(), jpegData.size());
+    for (int marker = 0; marker < 16; ++marker) {
+        jpeg_save_markers(&source, JPEG_APP0 + marker, 0xFFFF);
+    }
+    jpeg_save_markers(&source, JPEG_COM, 0xFFFF);
+    jpeg_read_header(&source, TRUE);
+    jvirt_barray_ptr *sourceArrays = jpeg_read_coefficients(&source);
+
+    /* Exif orientations as a transpose followed by mirroring along the oriented axes */
+    static const bool orientations[8][3] = {
+            {false, false, false},
+            {false, true,  false},
+            {false, true,  true},
+            {false, false, true},
+            {true,  false, false},
+            {true,  true,  false},
+            {true,  true,  true},
+            {true,  false, true}
+    };
+    if (orientation < 1 || orientation > 8) {
+        orientation = 1;
+    }
+    bool transpose = orientations[orientation - 1][0];
+    bool mirrorX = orientations[orientation - 1][1];
+    bool mirrorY = orientations[orientation - 1][2];
+
+    int maxHorizontalFactor = 1;
+    int maxVerticalFactor = 1;
+    for (int component = 0; component < source.num_components; ++component) {
+        maxHorizontalFactor = qMax(maxHorizontalFactor, source.comp_info[component].h_samp_factor);
+        maxVerticalFactor = qMax(maxVerticalFactor, source.comp_info[component].v_samp_factor);
+    }
+    int orientedWidth = transpose ? source.image_height : source.image_width;
+    int orientedHeight = transpose ? source.image_width : source.image_height;
+    int mcuWidth = DCTSIZE * (transpose ? maxVerticalFactor : maxHorizontalFactor);
+    int mcuHeight = DCTSIZE * (transpose ? maxHorizontalFactor : maxVerticalFactor);
+
+    QRect crop = requestedCrop.isNull() ? QRect(0, 0, orientedWidth, orientedHeight) : requestedCrop;
+    if (crop.isEmpty() || !QRect(0, 0, orientedWidth, orientedHeight).contains(crop)) {
+        errorString = "Crop outside of the image";
+        return false;
+    }
+
+    /* The source iMCU grid must line up with the left and top edges of the result */
+    int misalignmentX = (mirrorX ? orientedWidth - crop.x() : mcuWidth - crop.x() % mcuWidth) % mcuWidth;
+    int misalignmentY = (mirrorY ? orientedHeight - crop.y() : mcuHeight - crop.y() % mcuHeight) % mcuHeight;
+    if (misalignmentX || misalignmentY) {
+        if (!trim) {
+            errorString = "Edges are not aligned to JPEG blocks";
+            return false;
+        }
+        crop.setLeft(crop.left() + misalignmentX);
+        crop.setTop(crop.top() + misalignmentY);
+        if (crop.isEmpty()) {
+            errorString = "Image too small to trim";
+            return false;
+        }
+    }
+
+    jpeg_copy_critical_parameters(&source, &destination);
+    destination.image_width = crop.width();
+    destination.image_height = crop.height();
+    destination.optimize_coding = TRUE;
+    if (source.progressive_mode) {
+        jpeg_simple_progression(&destination);
+    }
+
+    if (transpose) {
+        for (int component = 0; component < destination.num_components; ++component) {
+            jpeg_component_info *componentInfo = destination.comp_info + component;
+            qSwap(componentInfo->h_samp_factor, componentInfo->v_samp_factor);
+        }
+
+        for (int table = 0; table < NUM_QUANT_TBLS; ++table) {
+            JQUANT_TBL *quantTable = destination.quant_tbl_ptrs[table];
+            if (!quantTable) {
+                continue;
+            }
+            for (int v = 0; v < DCTSIZE; ++v) {
+                for (int u = v + 1; u < DCTSIZE; ++u) {
+                    qSwap(quantTable->quantval[v * DCTSIZE + u], quantTable->quantval[u * DCTSIZE + v]);
+                }
+            }
+        }
+    }
+
+    /* Sized like the library sizes them, whole iMCUs including the padding blocks */
+    int maxDestinationHorizontalFactor = transpose ? maxVerticalFactor : maxHorizontalFactor;
+    int maxDestinationVerticalFactor = transpose ? maxHorizontalFactor : maxVerticalFactor;
+    jvirt_barray_ptr *destinationArrays = (jvirt_barray_ptr *) (*destination.mem->alloc_small)(
+            (j_common_ptr) &destination, JPOOL_IMAGE, sizeof(jvirt_barray_ptr) * destination.num_components);
+    for (int component = 0; component < destination.num_components; ++component) {
+        jpeg_component_info *componentInfo = destination.comp_info + component;
+        int horizontalFactor = componentInfo->h_samp_factor;
+        int verticalFactor = componentInfo->v_samp_factor;
+        componentInfo->width_in_blocks = (JDIMENSION) (((long) crop.width() * horizontalFactor
+                                                        + maxDestinationHorizontalFactor * DCTSIZE - 1)
+                                                       / (maxDestinationHorizontalFactor * DCTSIZE));
+        componentInfo->height_in_blocks = (JDIMENSION) (((long) crop.height() * verticalFactor
+                                                         + maxDestinationVerticalFactor * DCTSIZE - 1)
+                                                        / (maxDestinationVerticalFactor * DCTSIZE));
+        JDIMENSION arrayWidth = ((componentInfo->width_in_blocks + horizontalFactor - 1) / horizontalFactor)
+                                * horizontalFactor;
+        JDIMENSION arrayHeight = ((componentInfo->height_in_blocks + verticalFactor - 1) / verticalFactor)
+                                 * verticalFactor;
+        destinationArrays[component] = (*destination.mem->request_virt_barray)(
+                (j_common_ptr) &destination, JPOOL_IMAGE, FALSE, arrayWidth, arrayHeight, verticalFactor);
+    }
+
+    jpeg_mem_dest(&destination, &state->outputBuffer, &state->outputSize);
+    jpeg_write_coefficients(&destination, destinationArrays);
+
+    for (jpeg_saved_marker_ptr marker = source.marker_list; marker; marker = marker->next) {
+        /* Already written from the copied parameters */
+        if ((destination.write_JFIF_header && isMarker(marker, JPEG_APP0, "JFIF", 5))
+            || (destination.write_Adobe_marker && isMarker(marker, JPEG_APP0 + 14, "Adobe", 5))) {
+            continue;
+        }
+        jpeg_write_marker(&destination, marker->marker, marker->data, marker->data_length);
+    }
+
+    transformCoefficients(state, sourceArrays, destinationArrays, crop, orientedWidth, orientedHeight,
+                          transpose, mirrorX, mirrorY);
+
+    jpeg_finish_compress(&destination);
+    jpeg_finish_decompress(&source);
+    return true;
+}
+
+bool LosslessJpeg::transform(const QByteArray &jpegData, long orientation, const QRect &crop, bool trim,
+                             QByteArray &transformedData, QString &errorString) {
+    if (!isJpeg(jpegData)) {
+        errorString = "Not a JPEG image";
+        return false;
+    }
+
+    JpegTransformState *state = new JpegTransformState;
+    state->outputBuffer = nullptr;
+    state->outputSize = 0;
+    state->source.err = jpeg_std_error(&state->error.manager);
+    state->destination.err = &state->error.manager;
+    state->error.manager.error_exit = onJpegError;
+    state->error.manager.output_message = onJpegMessage;
+    jpeg_create_decompress(&state->source);
+    jpeg_create_compress(&state->destination);
+
+    bool transformed = runTransform(state, jpegData, orientation, crop, trim, errorString);
+    if (transformed) {
+        transformedData = QByteArray((const char *) state->outputBuffer, (int) state->outputSize);
+    }
+
+    jpeg_destroy_compress(&state->destination);
+    jpeg_destroy_decompress(&state->source);
+    free(state->outputBuffer);
+    delete state;
+    return transformed;
+}
+
+bool LosslessJpeg::isJpeg(const QByteArray &data) {
+    return data.size() > 2 && (uchar) data[0] == 0xFF && (uchar) data[1] == 0xD8;
+}
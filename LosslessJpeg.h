@@ -0,0 +1,47 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOSSLESS_JPEG_H
+#define LOSSLESS_JPEG_H
+
+#include <QByteArray>
+#include <QString>
+#include <QRect>
+
+/*
+ * Orientation changes and crops of JPEG files done on the DCT coefficients, without
+ * decoding and recompressing the image. Quarter turns and flips move whole blocks and
+ * transpose or negate the coefficients inside them, a crop selects a range of blocks.
+ * This is exact as long as every edge that ends up on the left or top of the result is
+ * an iMCU boundary of the source. APPn and COM markers are carried over unchanged.
+ */
+class LosslessJpeg {
+
+public:
+    /*
+     * Applies an Exif orientation to the stored image, then crops it to a rectangle in
+     * the oriented image, a null crop keeps all of it. Without trim an unaligned crop
+     * or oriented edge fails, with trim the partial blocks along it are dropped.
+     */
+    static bool transform(const QByteArray &jpegData, long orientation, const QRect &crop, bool trim,
+                          QByteArray &transformedData, QString &errorString);
+
+    static bool isJpeg(const QByteArray &data);
+};
+
+#endif // LOSSLESS_JPEG_H
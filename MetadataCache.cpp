@@ -19,21 +19,105 @@
 #include <exiv2/exiv2.hpp>
 #include "Settings.h"
 #include "MetadataCache.h"
+#include "ImageHeaderParser.h"
+#include "XmpSidecar.h"
+
+/* All tag changes go through here so the inverted index stays in sync with the per image tags */
+void MetadataCache::setImageTagIds(const QString &imageFileName, const QBitArray &tagIds) {
+    QBitArray &currentTagIds = cache[imageFileName].tagIds;
+
+    int imageId = imageIds.value(imageFileName, -1);
+    if (imageId < 0) {
+        imageId = freeImageIds.isEmpty() ? imageIds.size() : freeImageIds.takeLast();
+        imageIds.insert(imageFileName, imageId);
+    }
+
+    int tagsCount = qMax(currentTagIds.size(), tagIds.size());
+    for (int tagId = 0; tagId < tagsCount; ++tagId) {
+        bool wasTagged = tagId < currentTagIds.size() && currentTagIds.testBit(tagId);
+        bool isTagged = tagId < tagIds.size() && tagIds.testBit(tagId);
+        if (wasTagged == isTagged) {
+            continue;
+        }
+
+        if (tagId >= taggedImages.size()) {
+            taggedImages.resize(tagId + 1);
+        }
+
+        QBitArray &images = taggedImages[tagId];
+        if (imageId >= images.size()) {
+            images.resize(qMax(imageId + 1, images.size() * 2));
+        }
+        images.setBit(imageId, isTagged);
+    }
+
+    currentTagIds = tagIds;
+}
 
 void MetadataCache::updateImageTags(QString &imageFileName, QSet<QString> tags) {
-    cache[imageFileName].tags = tags;
+    setImageTagIds(imageFileName, TagDictionary::toTagIds(tags));
 }
 
-bool MetadataCache::removeTagFromImage(QString &imageFileName, const QString &tagName) {
-    return cache[imageFileName].tags.remove(tagName);
+bool MetadataCache::removeTagFromImage(QString &imageFileName, int tagId) {
+    QBitArray tagIds = getImageTagIds(imageFileName);
+    if (tagId >= tagIds.size() || !tagIds.testBit(tagId)) {
+        return false;
+    }
+
+    tagIds.clearBit(tagId);
+    setImageTagIds(imageFileName, tagIds);
+    return true;
 }
 
 void MetadataCache::removeImage(QString &imageFileName) {
+    /* Clear its bits in the inverted index before the id goes to another image */
+    if (imageIds.contains(imageFileName)) {
+        setImageTagIds(imageFileName, QBitArray());
+        freeImageIds.append(imageIds.take(imageFileName));
+    }
     cache.remove(imageFileName);
 }
 
-QSet<QString> &MetadataCache::getImageTags(QString &imageFileName) {
-    return cache[imageFileName].tags;
+QBitArray MetadataCache::getImageTagIds(QString &imageFileName) {
+    QMap<QString, ImageMetadata>::const_iterator it = cache.constFind(imageFileName);
+    if (it == cache.constEnd()) {
+        return QBitArray();
+    }
+
+    return it->tagIds;
+}
+
+/* Tag names are only materialized when they are written back to the image */
+QSet<QString> MetadataCache::getImageTags(QString &imageFileName) {
+    return TagDictionary::toTagNames(getImageTagIds(imageFileName));
+}
+
+int MetadataCache::getImageId(const QString &imageFileName) const {
+    return imageIds.value(imageFileName, -1);
+}
+
+/* Returns the set of image ids having any (or with matchAll, every) of the given tags */
+QBitArray MetadataCache::getTaggedImages(const QBitArray &tagIds, bool matchAll) const {
+    QBitArray images;
+    bool firstTag = true;
+
+    for (int tagId = 0; tagId < tagIds.size(); ++tagId) {
+        if (!tagIds.testBit(tagId)) {
+            continue;
+        }
+
+        QBitArray tagImages = taggedImages.value(tagId);
+        if (firstTag) {
+            images = tagImages;
+            firstTag = false;
+        } else if (matchAll) {
+            images &= tagImages;
+        } else {
+            images |= tagImages;
+        }
+    }
+
+    return images;
 }
 
 long MetadataCache::getImageOrientation(QString &imageFileName) {
@@ -44,29 +128,43 @@ long MetadataCache::getImageOrientation(QString &imageFileName) {
     return 0;
 }
 
-void MetadataCache::setImageTags(const QString &imageFileName, QSet<QString> tags) {
-    ImageMetadata imageMetadata;
+bool MetadataCache::readImageMetadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags) {
+    return ImageHeaderParser::readMetadata(imageFullPath, orientation, tags)
+           || loadExiv2Metadata(imageFullPath, orientation, tags);
+}
+
+long MetadataCache::readImageOrientation(const QString &imageFullPath) {
+    QSet<QString> tags;
+    long orientation = 0;
 
-    imageMetadata.tags = tags;
-    cache.insert(imageFileName, imageMetadata);
+    readImageMetadata(imageFullPath, orientation, tags);
+    return orientation;
 }
 
-void MetadataCache::addTagToImage(QString &imageFileName, QString &tagName) {
-    if (cache[imageFileName].tags.contains(tagName)) {
-        return;
+void MetadataCache::setImageTags(const QString &imageFileName, QSet<QString> tags) {
+    cache[imageFileName].orientation = 0;
+    setImageTagIds(imageFileName, TagDictionary::toTagIds(tags));
+}
+
+void MetadataCache::addTagToImage(QString &imageFileName, int tagId) {
+    QBitArray tagIds = getImageTagIds(imageFileName);
+    if (tagId >= tagIds.size()) {
+        tagIds.resize(tagId + 1);
     }
 
-    cache[imageFileName].tags.insert(tagName);
+    tagIds.setBit(tagId);
+    setImageTagIds(imageFileName, tagIds);
 }
 
 void MetadataCache::clear() {
     cache.clear();
+    imageIds.clear();
+    freeImageIds.clear();
+    taggedImages.clear();
 }
 
-bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
+bool MetadataCache::loadExiv2Metadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags) {
     Exiv2::Image::AutoPtr exifImage;
-    QSet<QString> tags;
-    long orientation = 0;
 
     try {
         exifImage = Exiv2::ImageFactory::open(imageFullPath.toStdString());
@@ -87,13 +185,10 @@ bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
     try {
         Exiv2::IptcData &iptcData = exifImage->iptcData();
         if (!iptcData.empty()) {
-            QString key;
             Exiv2::IptcData::iterator end = iptcData.end();
             for (Exiv2::IptcData::iterator iptcIt = iptcData.begin(); iptcIt != end; ++iptcIt) {
                 if (iptcIt->tagName() == "Keywords") {
-                    QString tagName = QString::fromUtf8(iptcIt->toString().c_str());
-                    tags.insert(tagName);
-                    Settings::knownTags.insert(tagName);
+                    tags.insert(QString::fromUtf8(iptcIt->toString().c_str()));
                 }
             }
         }
@@ -101,19 +196,42 @@ bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
         qWarning() << "Failed to read Iptc metadata";
     }
 
-    ImageMetadata imageMetadata;
-    if (tags.size()) {
-        imageMetadata.tags = tags;
+    return true;
+}
+
+bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
+    QSet<QString> tags;
+    long orientation = 0;
+
+    /* Files indexed from the command line and unchanged since skip parsing */
+    if (!index.find(imageFullPath, orientation, tags) && !readImageMetadata(imageFullPath, orientation, tags)) {
+        return false;
+    }
+
+    /* A sidecar is written with the complete tag set, so it replaces the embedded keywords */
+    if (Settings::tagsSidecarEnabled) {
+        QSet<QString> sidecarTags;
+        if (XmpSidecar::readTags(imageFullPath, sidecarTags)) {
+            tags = sidecarTags;
+        }
     }
 
-    if (orientation) {
-        imageMetadata.orientation = orientation;
+    QBitArray tagIds;
+    if (tags.size()) {
+        tagIds = TagDictionary::toTagIds(tags);
+
+        /* Known tags share the interned string instead of keeping their own copy */
+        for (int tagId = 0; tagId < tagIds.size(); ++tagId) {
+            if (tagIds.testBit(tagId)) {
+                Settings::knownTags.insert(TagDictionary::name(tagId));
+            }
+        }
     }
 
-    if (tags.size() || orientation) {
-        cache.insert(imageFullPath, imageMetadata);
+    if (tags.size() || orientation || cache.contains(imageFullPath)) {
+        cache[imageFullPath].orientation = orientation;
+        setImageTagIds(imageFullPath, tagIds);
     }
 
     return true;
 }
-
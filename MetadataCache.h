@@ -20,28 +20,50 @@
 #define META_DATA_CACHE_H
 
 #include <QtWidgets>
+#include "TagDictionary.h"
+#include "MetadataIndex.h"
 
 class ImageMetadata {
 public:
-    QSet<QString> tags;
-    long orientation;
+    /* Bit n is set when the image has the tag with TagDictionary id n */
+    QBitArray tagIds;
+    long orientation = 0;
 };
 
 class MetadataCache {
 
 private:
     QMap<QString, ImageMetadata> cache;
+    QHash<QString, int> imageIds;
+
+    /* Ids of removed images, reused before new ones are handed out */
+    QVector<int> freeImageIds;
+
+    /* Inverted index, bit n of taggedImages[tagId] is set when image id n has the tag */
+    QVector<QBitArray> taggedImages;
+
+    MetadataIndex index;
+
+    void setImageTagIds(const QString &imageFileName, const QBitArray &tagIds);
+
+    static bool loadExiv2Metadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags);
 
 public:
     void updateImageTags(QString &imageFileName, QSet<QString> tags);
 
-    void addTagToImage(QString &imageFileName, QString &tagName);
+    void addTagToImage(QString &imageFileName, int tagId);
 
-    bool removeTagFromImage(QString &imageFileName, const QString &tagName);
+    bool removeTagFromImage(QString &imageFileName, int tagId);
 
     void removeImage(QString &imageFileName);
 
-    QSet<QString> &getImageTags(QString &imageFileName);
+    QBitArray getImageTagIds(QString &imageFileName);
+
+    QSet<QString> getImageTags(QString &imageFileName);
+
+    int getImageId(const QString &imageFileName) const;
+
+    QBitArray getTaggedImages(const QBitArray &tagIds, bool matchAll) const;
 
     void setImageTags(const QString &imageFileName, QSet<QString> tags);
 
@@ -51,6 +73,11 @@ public:
 
     long getImageOrientation(QString &imageFileName);
 
+    /* Straight from the file, bypassing the cache, safe to call from any thread */
+    static long readImageOrientation(const QString &imageFullPath);
+
+    static bool readImageMetadata(const QString &imageFullPath, long &orientation, QSet<QString> &tags);
+
 };
 
 #endif // META_DATA_CACHE_H
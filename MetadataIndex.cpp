@@ -0,0 +1,153 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include "MetadataIndex.h"
+
+#define METADATA_INDEX_MAGIC 0x50544D49
+
+MetadataIndex::MetadataIndex() {
+    loaded = false;
+}
+
+QString MetadataIndex::getIndexPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/metadata.index";
+}
+
+bool MetadataIndex::load() {
+    QMutexLocker locker(&mutex);
+    loaded = true;
+    entries.clear();
+
+    QFile indexFile(getIndexPath());
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&indexFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    quint32 version;
+    qint32 count;
+    stream >> magic >> version >> count;
+    if (magic != METADATA_INDEX_MAGIC || version != METADATA_INDEX_VERSION || count < 0) {
+        return false;
+    }
+
+    entries.reserve(count);
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString imageFullPath;
+        Entry entry;
+        stream >> imageFullPath >> entry.modified >> entry.size >> entry.orientation >> entry.tags;
+        entries.insert(imageFullPath, entry);
+    }
+
+    /* A truncated index is dropped as a whole */
+    if (stream.status() != QDataStream::Ok) {
+        entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool MetadataIndex::save() {
+    QMutexLocker locker(&mutex);
+    QString indexPath = getIndexPath();
+    if (!QDir().mkpath(QFileInfo(indexPath).absolutePath())) {
+        return false;
+    }
+
+    QSaveFile indexFile(indexPath);
+    if (!indexFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&indexFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << (quint32) METADATA_INDEX_MAGIC << (quint32) METADATA_INDEX_VERSION << (qint32) entries.size();
+    for (QHash<QString, Entry>::const_iterator entry = entries.constBegin(); entry != entries.constEnd(); ++entry) {
+        stream << entry.key() << entry->modified << entry->size << entry->orientation << entry->tags;
+    }
+
+    return stream.status() == QDataStream::Ok && indexFile.commit();
+}
+
+bool MetadataIndex::find(const QString &imageFullPath, long &orientation, QSet<QString> &tags) {
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        locker.unlock();
+        load();
+        locker.relock();
+    }
+
+    QHash<QString, Entry>::const_iterator entry = entries.constFind(imageFullPath);
+    if (entry == entries.constEnd()) {
+        return false;
+    }
+
+    QFileInfo imageFileInfo(imageFullPath);
+    if (imageFileInfo.lastModified().toMSecsSinceEpoch() != entry->modified || imageFileInfo.size() != entry->size) {
+        return false;
+    }
+
+    orientation = entry->orientation;
+    tags = entry->tags.toSet();
+    return true;
+}
+
+void MetadataIndex::insert(const QString &imageFullPath, long orientation, const QSet<QString> &tags) {
+    QFileInfo imageFileInfo(imageFullPath);
+    Entry entry;
+    entry.modified = imageFileInfo.lastModified().toMSecsSinceEpoch();
+    entry.size = imageFileInfo.size();
+    entry.orientation = (qint32) orientation;
+    entry.tags = tags.toList();
+
+    QMutexLocker locker(&mutex);
+    entries.insert(imageFullPath, entry);
+}
+
+int MetadataIndex::prune(const QString &directory, const QSet<QString> &keepFiles) {
+    QMutexLocker locker(&mutex);
+    QString prefix = QDir(directory).absolutePath() + "/";
+    int prunedCount = 0;
+
+    QHash<QString, Entry>::iterator entry = entries.begin();
+    while (entry != entries.end()) {
+        if (entry.key().startsWith(prefix) && !keepFiles.contains(entry.key())) {
+            entry = entries.erase(entry);
+            ++prunedCount;
+        } else {
+            ++entry;
+        }
+    }
+
+    return prunedCount;
+}
+
+int MetadataIndex::size() {
+    QMutexLocker locker(&mutex);
+    return entries.size();
+}
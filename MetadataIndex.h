@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#define METADATA_INDEX_VERSION 1
+
+/*
+ * Orientation and embedded keywords of image files, stored in the user's cache directory.
+ * It is filled by the index command line mode, so browsing a large photo tree does not
+ * parse every file again. An entry is only used while the file's modification time and
+ * size still match. Lookups and inserts are thread safe.
+ */
+class MetadataIndex {
+
+public:
+    MetadataIndex();
+
+    static QString getIndexPath();
+
+    bool load();
+
+    bool save();
+
+    bool find(const QString &imageFullPath, long &orientation, QSet<QString> &tags);
+
+    void insert(const QString &imageFullPath, long orientation, const QSet<QString> &tags);
+
+    /* Drops entries of files below the directory that are not in keepFiles */
+    int prune(const QString &directory, const QSet<QString> &keepFiles);
+
+    int size();
+
+private:
+    struct Entry {
+        qint64 modified;
+        qint64 size;
+        qint32 orientation;
+        QStringList tags;
+    };
+
+    QMutex mutex;
+    QHash<QString, Entry> entries;
+    bool loaded;
+};
+
+#endif // METADATA_INDEX_H
@@ -0,0 +1,164 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OrientationKernel.h"
+
+struct Pixel24 {
+    uchar bytes[3];
+};
+
+/* origin points to the source pixel of destination 0,0, the steps are the source byte offsets of x + 1 and y + 1 */
+template<typename Pixel>
+static void orientPixels(const uchar *origin, qptrdiff stepX, qptrdiff stepY,
+                         uchar *destBits, int destBytesPerLine, int destWidth, int destHeight) {
+    for (int blockY = 0; blockY < destHeight; blockY += ORIENTATION_BLOCK_SIZE) {
+        int lastY = qMin(blockY + ORIENTATION_BLOCK_SIZE, destHeight);
+
+        for (int blockX = 0; blockX < destWidth; blockX += ORIENTATION_BLOCK_SIZE) {
+            int lastX = qMin(blockX + ORIENTATION_BLOCK_SIZE, destWidth);
+
+            for (int y = blockY; y < lastY; ++y) {
+                Pixel *dest = (Pixel *) (destBits + (qptrdiff) y * destBytesPerLine);
+                const uchar *source = origin + y * stepY + blockX * stepX;
+                for (int x = blockX; x < lastX; ++x) {
+                    dest[x] = *(const Pixel *) source;
+                    source += stepX;
+                }
+            }
+        }
+    }
+}
+
+QImage OrientationKernel::apply(const QImage &image, long orientation) {
+    if (orientation < 2 || orientation > 8 || image.isNull()) {
+        return image;
+    }
+
+    QImage source = image;
+    if (source.depth() < 8) {
+        source = source.convertToFormat(QImage::Format_Indexed8);
+    }
+
+    int pixelSize = source.depth() / 8;
+    if (pixelSize != 1 && pixelSize != 2 && pixelSize != 3 && pixelSize != 4 && pixelSize != 8) {
+        return apply(source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32
+                                                                     : QImage::Format_RGB32), orientation);
+    }
+
+    int width = source.width();
+    int height = source.height();
+    bool transposed = orientation >= 5;
+    QImage oriented(transposed ? height : width, transposed ? width : height, source.format());
+    if (oriented.isNull()) {
+        return QImage();
+    }
+    oriented.setColorTable(source.colorTable());
+    oriented.setDotsPerMeterX(transposed ? source.dotsPerMeterY() : source.dotsPerMeterX());
+    oriented.setDotsPerMeterY(transposed ? source.dotsPerMeterX() : source.dotsPerMeterY());
+    oriented.setDevicePixelRatio(source.devicePixelRatio());
+
+    const uchar *sourceBits = source.constBits();
+    qptrdiff bytesPerLine = source.bytesPerLine();
+    qptrdiff lastColumn = (qptrdiff) (width - 1) * pixelSize;
+    qptrdiff lastLine = (height - 1) * bytesPerLine;
+    const uchar *origin = sourceBits;
+    qptrdiff stepX = pixelSize;
+    qptrdiff stepY = bytesPerLine;
+
+    switch (orientation) {
+        case 2:
+            origin = sourceBits + lastColumn;
+            stepX = -pixelSize;
+            break;
+        case 3:
+            origin = sourceBits + lastLine + lastColumn;
+            stepX = -pixelSize;
+            stepY = -bytesPerLine;
+            break;
+        case 4:
+            origin = sourceBits + lastLine;
+            stepY = -bytesPerLine;
+            break;
+        case 5:
+            stepX = bytesPerLine;
+            stepY = pixelSize;
+            break;
+        case 6:
+            origin = sourceBits + lastLine;
+            stepX = -bytesPerLine;
+            stepY = pixelSize;
+            break;
+        case 7:
+            origin = sourceBits + lastLine + lastColumn;
+            stepX = -bytesPerLine;
+            stepY = -pixelSize;
+            break;
+        case 8:
+            origin = sourceBits + lastColumn;
+            stepX = bytesPerLine;
+            stepY = -pixelSize;
+            break;
+    }
+
+    uchar *destBits = oriented.bits();
+    int destBytesPerLine = oriented.bytesPerLine();
+    switch (pixelSize) {
+        case 1:
+            orientPixels<quint8>(origin, stepX, stepY, destBits, destBytesPerLine, oriented.width(), oriented.height());
+            break;
+        case 2:
+            orientPixels<quint16>(origin, stepX, stepY, destBits, destBytesPerLine, oriented.width(), oriented.height());
+            break;
+        case 3:
+            orientPixels<Pixel24>(origin, stepX, stepY, destBits, destBytesPerLine, oriented.width(), oriented.height());
+            break;
+        case 4:
+            orientPixels<quint32>(origin, stepX, stepY, destBits, destBytesPerLine, oriented.width(), oriented.height());
+            break;
+        case 8:
+            orientPixels<quint64>(origin, stepX, stepY, destBits, destBytesPerLine, oriented.width(), oriented.height());
+            break;
+    }
+
+    return oriented;
+}
+
+long OrientationKernel::getOrientation(const QTransform &transform) {
+    static const qreal matrices[8][4] = {
+            {1,  0,  0,  1},
+            {-1, 0,  0,  1},
+            {-1, 0,  0,  -1},
+            {1,  0,  0,  -1},
+            {0,  1,  1,  0},
+            {0,  1,  -1, 0},
+            {0,  -1, -1, 0},
+            {0,  -1, 1,  0}
+    };
+
+    if (transform.type() > QTransform::TxRotate) {
+        return 0;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        if (transform.m11() == matrices[i][0] && transform.m12() == matrices[i][1]
+            && transform.m21() == matrices[i][2] && transform.m22() == matrices[i][3]) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
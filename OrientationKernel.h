@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORIENTATION_KERNEL_H
+#define ORIENTATION_KERNEL_H
+
+#include <QImage>
+#include <QTransform>
+
+#define ORIENTATION_BLOCK_SIZE 64
+
+/*
+ * Exact pixel shuffles for the eight Exif orientations, done in one pass without resampling.
+ * The destination is written in square blocks, so the transposing orientations read each
+ * source line a block at a time instead of striding down a whole column per pixel.
+ */
+class OrientationKernel {
+
+public:
+    static QImage apply(const QImage &image, long orientation);
+
+    /* The orientation matching the linear part of the transform, 0 when it is not a quarter turn or flip */
+    static long getOrientation(const QTransform &transform);
+};
+
+#endif // ORIENTATION_KERNEL_H
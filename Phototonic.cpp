@@ -30,6 +30,7 @@
 #include "RenameDialog.h"
 #include "Trashcan.h"
 #include "MessageBox.h"
+#include "XmpSidecar.h"
 
 Phototonic::Phototonic(QStringList argumentsList, int filesStartAt, QWidget *parent) : QMainWindow(parent) {
     Settings::appSettings = new QSettings("phototonic", "phototonic");
@@ -65,6 +66,12 @@ Phototonic::Phototonic(QStringList argumentsList, int filesStartAt, QWidget *par
     processStartupArguments(argumentsList, filesStartAt);
 
     copyMoveToDialog = nullptr;
+    removeMetadataJob = nullptr;
+    removeMetadataProgressDialog = nullptr;
+    normalizeOrientationJob = nullptr;
+    normalizeOrientationProgressDialog = nullptr;
+    batchProcessJob = nullptr;
+    batchProcessProgressDialog = nullptr;
     colorsDialog = nullptr;
     cropDialog = nullptr;
     initComplete = true;
@@ -133,6 +140,7 @@ bool Phototonic::event(QEvent *event) {
 
 void Phototonic::createThumbsViewer() {
     metadataCache = new MetadataCache;
+    imageCache = new ImageCache;
     thumbsViewer = new ThumbsViewer(this, metadataCache);
     thumbsViewer->thumbsSortFlags = (QDir::SortFlags) Settings::appSettings->value(
             Settings::optionThumbsSortFlags).toInt();
@@ -155,7 +163,7 @@ void Phototonic::addMenuSeparator(QWidget *widget) {
 }
 
 void Phototonic::createImageViewer() {
-    imageViewer = new ImageViewer(this, metadataCache);
+    imageViewer = new ImageViewer(this, metadataCache, imageCache);
     connect(saveAction, SIGNAL(triggered()), imageViewer, SLOT(saveImage()));
     connect(saveAsAction, SIGNAL(triggered()), imageViewer, SLOT(saveImageAs()));
     connect(copyImageAction, SIGNAL(triggered()), imageViewer, SLOT(copyImage()));
@@ -397,6 +405,14 @@ void Phototonic::createActions() {
     removeMetadataAction->setObjectName("removeMetadata");
     connect(removeMetadataAction, SIGNAL(triggered()), this, SLOT(removeMetadata()));
 
+    normalizeOrientationAction = new QAction(tr("Normalize Orientation"), this);
+    normalizeOrientationAction->setObjectName("normalizeOrientation");
+    connect(normalizeOrientationAction, SIGNAL(triggered()), this, SLOT(normalizeOrientation()));
+
+    batchProcessAction = new QAction(tr("Batch Process"), this);
+    batchProcessAction->setObjectName("batchProcess");
+    connect(batchProcessAction, SIGNAL(triggered()), this, SLOT(batchProcess()));
+
     selectAllAction = new QAction(tr("Select All"), this);
     selectAllAction->setObjectName("selectAll");
     connect(selectAllAction, SIGNAL(triggered()), this, SLOT(selectAllThumbs()));
@@ -705,6 +721,8 @@ void Phototonic::createMenus() {
     editMenu->addAction(pasteAction);
     editMenu->addAction(renameAction);
     editMenu->addAction(removeMetadataAction);
+    editMenu->addAction(normalizeOrientationAction);
+    editMenu->addAction(batchProcessAction);
     editMenu->addAction(deleteAction);
     editMenu->addAction(deletePermanentlyAction);
     editMenu->addSeparator();
@@ -760,6 +778,8 @@ void Phototonic::createMenus() {
     thumbsViewer->addAction(moveToAction);
     thumbsViewer->addAction(renameAction);
     thumbsViewer->addAction(removeMetadataAction);
+    thumbsViewer->addAction(normalizeOrientationAction);
+    thumbsViewer->addAction(batchProcessAction);
     thumbsViewer->addAction(deleteAction);
     thumbsViewer->addAction(deletePermanentlyAction);
     addMenuSeparator(thumbsViewer);
@@ -980,7 +1000,6 @@ void Phototonic::createImageTagsDock() {
 
     connect(tagsDock->toggleViewAction(), SIGNAL(triggered()), this, SLOT(setTagsDockVisibility()));
     connect(tagsDock, SIGNAL(visibilityChanged(bool)), this, SLOT(setTagsDockVisibility()));
-    connect(thumbsViewer->imageTags, SIGNAL(reloadThumbs()), this, SLOT(onReloadThumbs()));
     connect(thumbsViewer->imageTags->removeTagAction, SIGNAL(triggered()), this, SLOT(deleteOperation()));
 }
 
@@ -1469,7 +1488,7 @@ void Phototonic::freeRotateLeft() {
     --Settings::rotation;
     if (Settings::rotation < 0)
         Settings::rotation = 359;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
     imageViewer->setFeedback(tr("Rotation %1°").arg(QString::number(Settings::rotation)));
 }
 
@@ -1477,7 +1496,7 @@ void Phototonic::freeRotateRight() {
     ++Settings::rotation;
     if (Settings::rotation > 360)
         Settings::rotation = 1;
-    imageViewer->refresh();
+    imageViewer->refreshPreview();
     imageViewer->setFeedback(tr("Rotation %1°").arg(QString::number(Settings::rotation)));
 }
 
@@ -1515,32 +1534,27 @@ void Phototonic::moveDown() {
 }
 
 void Phototonic::setMirrorDisabled() {
-    imageViewer->mirrorLayout = ImageViewer::LayNone;
-    imageViewer->refresh();
+    imageViewer->setMirrorLayout(ImageViewer::LayNone);
     imageViewer->setFeedback(tr("Mirroring Disabled"));
 }
 
 void Phototonic::setMirrorDual() {
-    imageViewer->mirrorLayout = ImageViewer::LayDual;
-    imageViewer->refresh();
+    imageViewer->setMirrorLayout(ImageViewer::LayDual);
     imageViewer->setFeedback(tr("Mirroring: Dual"));
 }
 
 void Phototonic::setMirrorTriple() {
-    imageViewer->mirrorLayout = ImageViewer::LayTriple;
-    imageViewer->refresh();
+    imageViewer->setMirrorLayout(ImageViewer::LayTriple);
     imageViewer->setFeedback(tr("Mirroring: Triple"));
 }
 
 void Phototonic::setMirrorVDual() {
-    imageViewer->mirrorLayout = ImageViewer::LayVDual;
-    imageViewer->refresh();
+    imageViewer->setMirrorLayout(ImageViewer::LayVDual);
     imageViewer->setFeedback(tr("Mirroring: Dual Vertical"));
 }
 
 void Phototonic::setMirrorQuad() {
-    imageViewer->mirrorLayout = ImageViewer::LayQuad;
-    imageViewer->refresh();
+    imageViewer->setMirrorLayout(ImageViewer::LayQuad);
     imageViewer->setFeedback(tr("Mirroring: Quad"));
 }
 
@@ -1651,6 +1665,19 @@ void Phototonic::loadCurrentImage(int currentRow) {
     thumbsViewer->setImageViewerWindowTitle();
 }
 
+/* A sidecar left behind would attach its tags to the next image saved under the same name */
+void Phototonic::deleteSidecar(const QString &imageFileName, bool trash) {
+    QString sidecarFileName = XmpSidecar::fileName(imageFileName);
+    if (!QFile::exists(sidecarFileName)) {
+        return;
+    }
+
+    QString trashError;
+    if (!trash || Trash::moveToTrash(sidecarFileName, trashError) != Trash::Success) {
+        XmpSidecar::remove(imageFileName);
+    }
+}
+
 void Phototonic::deleteImages(bool trash) {
     // Deleting selected thumbnails
     if (thumbsViewer->selectionModel()->selectedIndexes().size() < 1) {
@@ -1698,6 +1725,7 @@ void Phototonic::deleteImages(bool trash) {
 
         ++deleteFilesCount;
         if (deleteOk) {
+            deleteSidecar(fileNameFullPath, trash);
             row = indexesList.first().row();
             rows << row;
             thumbsViewer->thumbsViewerModel->removeRow(row);
@@ -1773,6 +1801,7 @@ void Phototonic::deleteFromViewer(bool trash) {
         ok = trash ? (Trash::moveToTrash(imageViewer->viewerImageFullPath, trashError) == Trash::Success)
                    : QFile::remove(imageViewer->viewerImageFullPath);
         if (ok) {
+            deleteSidecar(imageViewer->viewerImageFullPath, trash);
             thumbsViewer->thumbsViewerModel->removeRow(currentRow);
             imageViewer->setFeedback(tr("Deleted ") + fileName);
         } else {
@@ -1991,6 +2020,7 @@ void Phototonic::writeSettings() {
     Settings::appSettings->setValue(Settings::optionHideDockTitlebars, (bool) Settings::hideDockTitlebars);
     Settings::appSettings->setValue(Settings::optionShowViewerToolbar, (bool) Settings::showViewerToolbar);
     Settings::appSettings->setValue(Settings::optionSetWindowIcon, (bool) Settings::setWindowIcon);
+    Settings::appSettings->setValue(Settings::optionTagsSidecarEnabled, (bool) Settings::tagsSidecarEnabled);
 
     /* Action shortcuts */
     Settings::appSettings->beginGroup(Settings::optionShortcuts);
@@ -2118,6 +2148,7 @@ void Phototonic::readSettings() {
     Settings::hideDockTitlebars = Settings::appSettings->value(Settings::optionHideDockTitlebars).toBool();
     Settings::showViewerToolbar = Settings::appSettings->value(Settings::optionShowViewerToolbar).toBool();
     Settings::setWindowIcon = Settings::appSettings->value(Settings::optionSetWindowIcon).toBool();
+    Settings::tagsSidecarEnabled = Settings::appSettings->value(Settings::optionTagsSidecarEnabled).toBool();
 
     /* read external apps */
     Settings::appSettings->beginGroup(Settings::optionExternalApps);
@@ -2139,7 +2170,8 @@ void Phototonic::readSettings() {
     Settings::appSettings->beginGroup(Settings::optionKnownTags);
     QStringList tags = Settings::appSettings->childKeys();
     for (int i = 0; i < tags.size(); ++i) {
-        Settings::knownTags.insert(Settings::appSettings->value(tags.at(i)).toString());
+        int tagId = TagDictionary::intern(Settings::appSettings->value(tags.at(i)).toString());
+        Settings::knownTags.insert(TagDictionary::name(tagId));
     }
     Settings::appSettings->endGroup();
 
@@ -2262,6 +2294,8 @@ void Phototonic::loadShortcuts() {
     Settings::actionKeys[createDirectoryAction->objectName()] = createDirectoryAction;
     Settings::actionKeys[addBookmarkAction->objectName()] = addBookmarkAction;
     Settings::actionKeys[removeMetadataAction->objectName()] = removeMetadataAction;
+    Settings::actionKeys[normalizeOrientationAction->objectName()] = normalizeOrientationAction;
+    Settings::actionKeys[batchProcessAction->objectName()] = batchProcessAction;
     Settings::actionKeys[externalAppsAction->objectName()] = externalAppsAction;
     Settings::actionKeys[goHomeAction->objectName()] = goHomeAction;
     Settings::actionKeys[sortByNameAction->objectName()] = sortByNameAction;
@@ -2358,6 +2392,10 @@ void Phototonic::closeEvent(QCloseEvent *event) {
     thumbsViewer->abort();
     writeSettings();
     hide();
+
+    /* Pending tag changes are also journaled, but finish writing them if we can */
+    thumbsViewer->imageTags->tagWriteQueue->waitForDone();
+
     if (!QApplication::clipboard()->image().isNull()) {
         QApplication::clipboard()->clear();
     }
@@ -2592,6 +2630,18 @@ void Phototonic::loadSelectedThumbImage(const QModelIndex &idx) {
     imageViewer->loadImage(
             thumbsViewer->thumbsViewerModel->item(idx.row())->data(thumbsViewer->FileNameRole).toString());
     thumbsViewer->setImageViewerWindowTitle();
+    prefetchAdjacentImages(true);
+}
+
+/* Decode the images the user is likely to step to next while the current one is shown */
+void Phototonic::prefetchAdjacentImages(bool forward) {
+    if (Settings::layoutMode != ImageViewWidget) {
+        return;
+    }
+
+    QStringList prefetchList = thumbsViewer->getAdjacentImages(forward, PREFETCH_AHEAD_COUNT);
+    prefetchList += thumbsViewer->getAdjacentImages(!forward, PREFETCH_BEHIND_COUNT);
+    imageViewer->imagePrefetcher->prefetch(prefetchList);
 }
 
 void Phototonic::loadImageFromCliArguments(QString cliFileName) {
@@ -2617,14 +2667,14 @@ void Phototonic::toggleSlideShow() {
         delete SlideShowTimer;
         slideShowAction->setIcon(QIcon::fromTheme("media-playback-start", QIcon(":/images/play.png")));
     } else {
-        if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+        if (thumbsViewer->getVisibleThumbsCount() <= 0) {
             return;
         }
 
         if (Settings::layoutMode == ThumbViewWidget) {
             QModelIndexList indexesList = thumbsViewer->selectionModel()->selectedIndexes();
             if (indexesList.size() != 1) {
-                thumbsViewer->setCurrentRow(0);
+                thumbsViewer->setCurrentRow(thumbsViewer->getFirstRow());
             } else {
                 thumbsViewer->setCurrentRow(indexesList.first().row());
             }
@@ -2633,8 +2683,14 @@ void Phototonic::toggleSlideShow() {
         }
 
         Settings::slideShowActive = true;
+        slideShowSeed = (uint) qrand();
+        slideShowOrder = thumbsViewer->getSlideShowOrder(Settings::slideShowRandom, Settings::wrapImageList,
+                                                         thumbsViewer->getCurrentRow(), slideShowSeed++);
+        slideShowPosition = 0;
 
+        /* Slides are decoded ahead of time, a tick only swaps images so it can keep exact intervals */
         SlideShowTimer = new QTimer(this);
+        SlideShowTimer->setTimerType(Qt::PreciseTimer);
         connect(SlideShowTimer, SIGNAL(timeout()), this, SLOT(slideShowHandler()));
         SlideShowTimer->start(Settings::slideShowDelay * 1000);
 
@@ -2647,37 +2703,63 @@ void Phototonic::toggleSlideShow() {
 }
 
 void Phototonic::slideShowHandler() {
-    if (Settings::slideShowActive) {
-        if (Settings::slideShowRandom) {
-            loadRandomImage();
-        } else {
-            int currentRow = thumbsViewer->getCurrentRow();
-            imageViewer->loadImage(
-                    thumbsViewer->thumbsViewerModel->item(currentRow)->data(thumbsViewer->FileNameRole).toString());
-            thumbsViewer->setImageViewerWindowTitle();
+    if (!Settings::slideShowActive) {
+        return;
+    }
 
-            if (thumbsViewer->getNextRow() > 0) {
-                thumbsViewer->setCurrentRow(thumbsViewer->getNextRow());
-            } else {
-                if (Settings::wrapImageList) {
-                    thumbsViewer->setCurrentRow(0);
-                } else {
-                    toggleSlideShow();
-                }
-            }
+    /* Plan the next round while the prefetch can still reach into it, random slide shows are reshuffled */
+    if ((Settings::wrapImageList || Settings::slideShowRandom)
+        && slideShowOrder.size() - slideShowPosition <= SLIDESHOW_PREFETCH_COUNT) {
+        int startRow = slideShowOrder.isEmpty() ? thumbsViewer->getFirstRow()
+                                                : thumbsViewer->getRowByName(slideShowOrder.last()) + 1;
+        QStringList nextRound = thumbsViewer->getSlideShowOrder(Settings::slideShowRandom, true, startRow,
+                                                               slideShowSeed++);
+        /* No image twice in a row across rounds */
+        if (nextRound.size() > 1 && !slideShowOrder.isEmpty() && nextRound.first() == slideShowOrder.last()) {
+            nextRound.swap(0, nextRound.size() - 1);
+        }
+        slideShowOrder = slideShowOrder.mid(slideShowPosition) + nextRound;
+        slideShowPosition = 0;
+    }
+
+    /* Planned by file name, images removed or filtered out since then are skipped */
+    int row = -1;
+    QString imageFileName;
+    while (row < 0 && slideShowPosition < slideShowOrder.size()) {
+        imageFileName = slideShowOrder.at(slideShowPosition++);
+        row = thumbsViewer->getRowByName(imageFileName);
+        if (row >= 0 && thumbsViewer->isRowHidden(row)) {
+            row = -1;
         }
     }
+
+    if (row < 0) {
+        toggleSlideShow();
+        return;
+    }
+
+    imageViewer->loadImage(imageFileName);
+    thumbsViewer->setCurrentRow(row);
+    thumbsViewer->setImageViewerWindowTitle();
+
+    if (slideShowPosition >= slideShowOrder.size() && !Settings::wrapImageList && !Settings::slideShowRandom) {
+        toggleSlideShow();
+        return;
+    }
+
+    /* Keep the next slides decoded at screen size */
+    imageViewer->imagePrefetcher->prefetch(slideShowOrder.mid(slideShowPosition, SLIDESHOW_PREFETCH_COUNT));
 }
 
 void Phototonic::loadNextImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getVisibleThumbsCount() <= 0) {
         return;
     }
 
     int nextThumb = thumbsViewer->getNextRow();
     if (nextThumb < 0) {
         if (Settings::wrapImageList) {
-            nextThumb = 0;
+            nextThumb = thumbsViewer->getFirstRow();
         } else {
             return;
         }
@@ -2690,6 +2772,7 @@ void Phototonic::loadNextImage() {
 
     thumbsViewer->setCurrentRow(nextThumb);
     thumbsViewer->setImageViewerWindowTitle();
+    prefetchAdjacentImages(true);
 
     if (Settings::layoutMode == ThumbViewWidget) {
         thumbsViewer->selectThumbByRow(nextThumb);
@@ -2697,7 +2780,7 @@ void Phototonic::loadNextImage() {
 }
 
 void Phototonic::loadPreviousImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getVisibleThumbsCount() <= 0) {
         return;
     }
 
@@ -2717,6 +2800,7 @@ void Phototonic::loadPreviousImage() {
 
     thumbsViewer->setCurrentRow(previousThumb);
     thumbsViewer->setImageViewerWindowTitle();
+    prefetchAdjacentImages(false);
 
     if (Settings::layoutMode == ThumbViewWidget) {
         thumbsViewer->selectThumbByRow(previousThumb);
@@ -2724,21 +2808,23 @@ void Phototonic::loadPreviousImage() {
 }
 
 void Phototonic::loadFirstImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getVisibleThumbsCount() <= 0) {
         return;
     }
 
-    imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(0)->data(thumbsViewer->FileNameRole).toString());
-    thumbsViewer->setCurrentRow(0);
+    int firstRow = thumbsViewer->getFirstRow();
+    imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(firstRow)->data(thumbsViewer->FileNameRole).toString());
+    thumbsViewer->setCurrentRow(firstRow);
     thumbsViewer->setImageViewerWindowTitle();
+    prefetchAdjacentImages(true);
 
     if (Settings::layoutMode == ThumbViewWidget) {
-        thumbsViewer->selectThumbByRow(0);
+        thumbsViewer->selectThumbByRow(firstRow);
     }
 }
 
 void Phototonic::loadLastImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getVisibleThumbsCount() <= 0) {
         return;
     }
 
@@ -2746,6 +2832,7 @@ void Phototonic::loadLastImage() {
     imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(lastRow)->data(thumbsViewer->FileNameRole).toString());
     thumbsViewer->setCurrentRow(lastRow);
     thumbsViewer->setImageViewerWindowTitle();
+    prefetchAdjacentImages(false);
 
     if (Settings::layoutMode == ThumbViewWidget) {
         thumbsViewer->selectThumbByRow(lastRow);
@@ -2753,7 +2840,7 @@ void Phototonic::loadLastImage() {
 }
 
 void Phototonic::loadRandomImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getVisibleThumbsCount() <= 0) {
         return;
     }
 
@@ -2796,6 +2883,7 @@ void Phototonic::hideViewer() {
 
     Settings::layoutMode = ThumbViewWidget;
     stackedLayout->setCurrentWidget(thumbsViewer);
+    imageViewer->imagePrefetcher->clear();
 
     setDocksVisibility(true);
     while (QApplication::overrideCursor()) {
@@ -3102,6 +3190,7 @@ void Phototonic::rename() {
     if (renameConfirmed) {
         QString newFileNameFullPath = currentFileInfo.absolutePath() + QDir::separator() + newFileName;
         if (currentFileFullPath.rename(newFileNameFullPath)) {
+            XmpSidecar::rename(currentFileInfo.absoluteFilePath(), newFileNameFullPath);
             QModelIndexList indexesList = thumbsViewer->selectionModel()->selectedIndexes();
             thumbsViewer->thumbsViewerModel->item(indexesList.first().row())->setData(newFileNameFullPath,
                                                                                       thumbsViewer->FileNameRole);
@@ -3131,6 +3220,11 @@ void Phototonic::rename() {
 
 void Phototonic::removeMetadata() {
 
+    if (removeMetadataJob) {
+        setStatus(tr("Metadata removal already in progress"));
+        return;
+    }
+
     QModelIndexList indexList = thumbsViewer->selectionModel()->selectedIndexes();
     QStringList fileList;
     copyCutThumbsCount = indexList.size();
@@ -3159,25 +3253,263 @@ void Phototonic::removeMetadata() {
     msgBox.setButtonText(MessageBox::Cancel, tr("Cancel"));
     int ret = msgBox.exec();
 
-    if (ret == MessageBox::Yes) {
-        for (int file = 0; file < fileList.size(); ++file) {
-            Exiv2::Image::AutoPtr image;
-            try {
-                image = Exiv2::ImageFactory::open(fileList[file].toStdString());
-                image->clearMetadata();
-                image->writeMetadata();
-                metadataCache->removeImage(fileList[file]);
-            }
-            catch (Exiv2::Error &error) {
-                msgBox.critical(tr("Error"), tr("Failed to remove Exif metadata."));
-                return;
-            }
+    if (ret != MessageBox::Yes) {
+        return;
+    }
+
+    /* Stripping runs on worker threads, the application stays usable meanwhile */
+    removeMetadataJob = new BatchJob(this, fileList, [](const QString &fileName, QString &errorString) -> bool {
+        try {
+            Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(fileName.toStdString());
+            image->clearMetadata();
+            image->writeMetadata();
+        }
+        catch (Exiv2::Error &error) {
+            errorString = QString::fromUtf8(error.what());
+            return false;
+        }
+        return true;
+    });
+
+    removeMetadataProgressDialog = new ProgressDialog(this);
+    removeMetadataProgressDialog->setWindowTitle(tr("Remove Metadata"));
+    removeMetadataProgressDialog->opLabel->setText(tr("Removing metadata from %n image(s)", "", fileList.size()));
+    removeMetadataProgressDialog->setProgress(0, fileList.size());
+    connect(removeMetadataJob, SIGNAL(progress(int, int)), removeMetadataProgressDialog, SLOT(setProgress(int, int)));
+    connect(removeMetadataProgressDialog, SIGNAL(aborted()), removeMetadataJob, SLOT(cancel()));
+    connect(removeMetadataProgressDialog, SIGNAL(rejected()), removeMetadataJob, SLOT(cancel()));
+    connect(removeMetadataJob, SIGNAL(finished()), this, SLOT(onRemoveMetadataFinished()));
+    removeMetadataProgressDialog->show();
+
+    removeMetadataJob->start();
+}
+
+void Phototonic::onRemoveMetadataFinished() {
+    QStringList succeededFiles = removeMetadataJob->getSucceededFiles();
+    QStringList failedFiles = removeMetadataJob->getFailedFiles();
+    QStringList errors = removeMetadataJob->getErrors();
+    bool cancelled = removeMetadataJob->isCancelled();
+
+    removeMetadataProgressDialog->close();
+    removeMetadataProgressDialog->deleteLater();
+    removeMetadataProgressDialog = nullptr;
+    removeMetadataJob->deleteLater();
+    removeMetadataJob = nullptr;
+
+    /* Orientation and tags are gone, reread them and redo the thumbnails */
+    for (int file = 0; file < succeededFiles.size(); ++file) {
+        metadataCache->removeImage(succeededFiles[file]);
+    }
+    thumbsViewer->invalidateThumbs(succeededFiles);
+
+    QItemSelection dummy;
+    thumbsViewer->onSelectionChanged(dummy);
+
+    if (failedFiles.size()) {
+        QString report;
+        for (int file = 0; file < failedFiles.size(); ++file) {
+            report += failedFiles.at(file) + ": " + errors.at(file) + "\n";
+        }
+
+        MessageBox msgBox(this);
+        msgBox.setDetailedText(report);
+        msgBox.critical(tr("Error"), tr("Failed to remove Exif metadata from %n image(s).", "", failedFiles.size()));
+    }
+
+    if (cancelled) {
+        setStatus(tr("Metadata removal cancelled, %n image(s) processed", "", succeededFiles.size()));
+    } else {
+        setStatus(tr("Metadata removed from %n image(s)", "", succeededFiles.size()));
+    }
+}
+
+void Phototonic::normalizeOrientation() {
+    if (normalizeOrientationJob) {
+        setStatus(tr("Orientation normalization already in progress"));
+        return;
+    }
+
+    QModelIndexList indexList = thumbsViewer->selectionModel()->selectedIndexes();
+    QStringList fileList;
+    for (int thumb = 0; thumb < indexList.size(); ++thumb) {
+        QString fileName = thumbsViewer->thumbsViewerModel->item(indexList[thumb].row())->data(
+                thumbsViewer->FileNameRole).toString();
+        QString suffix = QFileInfo(fileName).suffix().toLower();
+        if (suffix == "jpg" || suffix == "jpeg" || suffix == "jpe") {
+            fileList.append(fileName);
+        }
+    }
+
+    if (fileList.isEmpty()) {
+        setStatus(tr("No JPEG images selected"));
+        return;
+    }
+
+    if (Settings::slideShowActive) {
+        toggleSlideShow();
+    }
+
+    MessageBox msgBox(this);
+    msgBox.setText(tr("Rotate the selected JPEG images losslessly to match their Exif orientation?"));
+    msgBox.setInformativeText(tr("Where the width or height is not a multiple of the JPEG block size, "
+                                 "the partial blocks along the edges that become the left or top are "
+                                 "dropped, trimming up to 15 pixels."));
+    msgBox.setWindowTitle(tr("Normalize Orientation"));
+    msgBox.setIcon(MessageBox::Warning);
+    msgBox.setStandardButtons(MessageBox::Yes | MessageBox::Cancel);
+    msgBox.setDefaultButton(MessageBox::Cancel);
+    msgBox.setButtonText(MessageBox::Yes, tr("Normalize"));
+    msgBox.setButtonText(MessageBox::Cancel, tr("Cancel"));
+    if (msgBox.exec() != MessageBox::Yes) {
+        return;
+    }
+
+    normalizeOrientationJob = new BatchJob(this, fileList, ImageSaver::normalizeOrientation);
+
+    normalizeOrientationProgressDialog = new ProgressDialog(this);
+    normalizeOrientationProgressDialog->setWindowTitle(tr("Normalize Orientation"));
+    normalizeOrientationProgressDialog->opLabel->setText(tr("Normalizing %n image(s)", "", fileList.size()));
+    normalizeOrientationProgressDialog->setProgress(0, fileList.size());
+    connect(normalizeOrientationJob, SIGNAL(progress(int, int)),
+            normalizeOrientationProgressDialog, SLOT(setProgress(int, int)));
+    connect(normalizeOrientationProgressDialog, SIGNAL(aborted()), normalizeOrientationJob, SLOT(cancel()));
+    connect(normalizeOrientationProgressDialog, SIGNAL(rejected()), normalizeOrientationJob, SLOT(cancel()));
+    connect(normalizeOrientationJob, SIGNAL(finished()), this, SLOT(onNormalizeOrientationFinished()));
+    normalizeOrientationProgressDialog->show();
+
+    normalizeOrientationJob->start();
+}
+
+void Phototonic::onNormalizeOrientationFinished() {
+    QStringList succeededFiles = normalizeOrientationJob->getSucceededFiles();
+    QStringList failedFiles = normalizeOrientationJob->getFailedFiles();
+    QStringList errors = normalizeOrientationJob->getErrors();
+    bool cancelled = normalizeOrientationJob->isCancelled();
+
+    normalizeOrientationProgressDialog->close();
+    normalizeOrientationProgressDialog->deleteLater();
+    normalizeOrientationProgressDialog = nullptr;
+    normalizeOrientationJob->deleteLater();
+    normalizeOrientationJob = nullptr;
+
+    for (int file = 0; file < succeededFiles.size(); ++file) {
+        metadataCache->removeImage(succeededFiles[file]);
+    }
+    thumbsViewer->invalidateThumbs(succeededFiles);
+
+    if (Settings::layoutMode == ImageViewWidget && succeededFiles.contains(imageViewer->viewerImageFullPath)) {
+        imageViewer->reload();
+    }
+
+    if (failedFiles.size()) {
+        QString report;
+        for (int file = 0; file < failedFiles.size(); ++file) {
+            report += failedFiles.at(file) + ": " + errors.at(file) + "\n";
+        }
+
+        MessageBox msgBox(this);
+        msgBox.setDetailedText(report);
+        msgBox.critical(tr("Error"), tr("Failed to normalize the orientation of %n image(s).", "", failedFiles.size()));
+    }
+
+    if (cancelled) {
+        setStatus(tr("Orientation normalization cancelled, %n image(s) processed", "", succeededFiles.size()));
+    } else {
+        setStatus(tr("Orientation normalized for %n image(s)", "", succeededFiles.size()));
+    }
+}
+
+void Phototonic::batchProcess() {
+    if (batchProcessJob) {
+        setStatus(tr("Batch processing already in progress"));
+        return;
+    }
+
+    QModelIndexList indexList = thumbsViewer->selectionModel()->selectedIndexes();
+    QStringList fileList;
+    for (int thumb = 0; thumb < indexList.size(); ++thumb) {
+        fileList.append(thumbsViewer->thumbsViewerModel->item(indexList[thumb].row())->data(
+                thumbsViewer->FileNameRole).toString());
+    }
+
+    if (fileList.isEmpty()) {
+        setStatus(tr("Invalid selection"));
+        return;
+    }
+
+    if (Settings::slideShowActive) {
+        toggleSlideShow();
+    }
+
+    BatchProcessDialog batchProcessDialog(this, fileList);
+    if (batchProcessDialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    /* Every worker decodes, processes and saves one file with its own copy of the options */
+    BatchProcessor::Options options = batchProcessDialog.getOptions();
+    batchProcessOptions = options;
+    batchProcessJob = new BatchJob(this, fileList, [options](const QString &fileName, QString &errorString) -> bool {
+        return BatchProcessor::processImage(fileName, options, errorString);
+    });
+
+    batchProcessProgressDialog = new ProgressDialog(this);
+    batchProcessProgressDialog->setWindowTitle(tr("Batch Process"));
+    batchProcessProgressDialog->opLabel->setText(tr("Processing %n image(s)", "", fileList.size()));
+    batchProcessProgressDialog->setProgress(0, fileList.size());
+    connect(batchProcessJob, SIGNAL(progress(int, int)), batchProcessProgressDialog, SLOT(setProgress(int, int)));
+    connect(batchProcessProgressDialog, SIGNAL(aborted()), batchProcessJob, SLOT(cancel()));
+    connect(batchProcessProgressDialog, SIGNAL(rejected()), batchProcessJob, SLOT(cancel()));
+    connect(batchProcessJob, SIGNAL(finished()), this, SLOT(onBatchProcessFinished()));
+    batchProcessProgressDialog->show();
+
+    batchProcessJob->start();
+}
+
+void Phototonic::onBatchProcessFinished() {
+    QStringList succeededFiles = batchProcessJob->getSucceededFiles();
+    QStringList failedFiles = batchProcessJob->getFailedFiles();
+    QStringList errors = batchProcessJob->getErrors();
+    bool cancelled = batchProcessJob->isCancelled();
+
+    batchProcessProgressDialog->close();
+    batchProcessProgressDialog->deleteLater();
+    batchProcessProgressDialog = nullptr;
+    batchProcessJob->deleteLater();
+    batchProcessJob = nullptr;
+
+    /* Originals may have been replaced, and new files may have appeared in the current directory */
+    QStringList replacedFiles;
+    bool newFilesShown = false;
+    for (int file = 0; file < succeededFiles.size(); ++file) {
+        QString outputFileName = BatchProcessor::getOutputFileName(succeededFiles[file], batchProcessOptions);
+        if (outputFileName == succeededFiles[file]) {
+            metadataCache->removeImage(succeededFiles[file]);
+            replacedFiles.append(succeededFiles[file]);
+        } else if (QFileInfo(outputFileName).absolutePath() == QDir(Settings::currentDirectory).absolutePath()) {
+            newFilesShown = true;
+        }
+    }
+    thumbsViewer->invalidateThumbs(replacedFiles);
+    if (newFilesShown) {
+        refreshThumbs(false);
+    }
+
+    if (failedFiles.size()) {
+        QString report;
+        for (int file = 0; file < failedFiles.size(); ++file) {
+            report += failedFiles.at(file) + ": " + errors.at(file) + "\n";
         }
 
-        QItemSelection dummy;
-        thumbsViewer->onSelectionChanged(dummy);
-        QString state = QString(tr("Metadata removed from selected images"));
-        setStatus(state);
+        MessageBox msgBox(this);
+        msgBox.setDetailedText(report);
+        msgBox.critical(tr("Error"), tr("Failed to process %n image(s).", "", failedFiles.size()));
+    }
+
+    if (cancelled) {
+        setStatus(tr("Batch processing cancelled, %n image(s) processed", "", succeededFiles.size()));
+    } else {
+        setStatus(tr("%n image(s) processed", "", succeededFiles.size()));
     }
 }
 
@@ -3326,6 +3658,7 @@ bool Phototonic::removeDirectoryOperation(QString dirToDelete) {
 }
 
 void Phototonic::cleanupCropDialog() {
+    imageViewer->finishPreview();
     setInterfaceEnabled(true);
 }
 
@@ -3336,6 +3669,7 @@ void Phototonic::cleanupResizeDialog() {
 }
 
 void Phototonic::cleanupColorsDialog() {
+    imageViewer->finishPreview();
     Settings::colorsActive = false;
     setInterfaceEnabled(true);
 }
@@ -3345,6 +3679,8 @@ void Phototonic::setInterfaceEnabled(bool enable) {
     colorsAction->setEnabled(enable);
     renameAction->setEnabled(enable);
     removeMetadataAction->setEnabled(enable);
+    normalizeOrientationAction->setEnabled(enable);
+    batchProcessAction->setEnabled(enable);
     cropAction->setEnabled(enable);
     resizeAction->setEnabled(enable);
     CloseImageAction->setEnabled(enable);
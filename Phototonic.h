@@ -27,8 +27,11 @@
 #include "CropDialog.h"
 #include "ColorsDialog.h"
 #include "ResizeDialog.h"
+#include "BatchProcessDialog.h"
 #include "FileListWidget.h"
 #include "FileSystemTree.h"
+#include "BatchJob.h"
+#include "ProgressDialog.h"
 #include <QStackedLayout>
 
 #define VERSION "Phototonic v2.1"
@@ -104,6 +107,16 @@ private slots:
 
     void removeMetadata();
 
+    void onRemoveMetadataFinished();
+
+    void normalizeOrientation();
+
+    void onNormalizeOrientationFinished();
+
+    void batchProcess();
+
+    void onBatchProcessFinished();
+
     void viewImage();
 
     void newImage();
@@ -303,6 +316,8 @@ private:
     QAction *saveAsAction;
     QAction *renameAction;
     QAction *removeMetadataAction;
+    QAction *normalizeOrientationAction;
+    QAction *batchProcessAction;
     QAction *selectAllAction;
     QAction *copyImageAction;
     QAction *pasteImageAction;
@@ -398,6 +413,9 @@ private:
     ImageViewer *imageViewer;
     QList<QString> pathHistoryList;
     QTimer *SlideShowTimer;
+    QStringList slideShowOrder;
+    int slideShowPosition;
+    uint slideShowSeed;
     CopyMoveToDialog *copyMoveToDialog;
     QWidget *fileSystemDockOrigWidget;
     QWidget *bookmarksDockOrigWidget;
@@ -411,6 +429,14 @@ private:
     QWidget *imageInfoDockEmptyWidget;
     bool interfaceDisabled;
     MetadataCache *metadataCache;
+    ImageCache *imageCache;
+    BatchJob *removeMetadataJob;
+    ProgressDialog *removeMetadataProgressDialog;
+    BatchJob *normalizeOrientationJob;
+    ProgressDialog *normalizeOrientationProgressDialog;
+    BatchJob *batchProcessJob;
+    ProgressDialog *batchProcessProgressDialog;
+    BatchProcessor::Options batchProcessOptions;
     FileListWidget *fileListWidget;
     QStackedLayout *stackedLayout;
 
@@ -442,6 +468,8 @@ private:
 
     void deleteFromViewer(bool trash);
 
+    void deleteSidecar(const QString &imageFileName, bool trash);
+
     void loadCurrentImage(int currentRow);
 
     void selectCurrentViewDir();
@@ -499,6 +527,8 @@ private:
     void copyOrMoveImages(bool move);
 
     void setViewerKeyEventsEnabled(bool enabled);
+
+    void prefetchAdjacentImages(bool forward);
 };
 
 #endif // PHOTOTONIC_H
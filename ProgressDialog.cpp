@@ -26,6 +26,9 @@ ProgressDialog::ProgressDialog(QWidget *parent) : QDialog(parent) {
     cancelButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
     connect(cancelButton, SIGNAL(clicked()), this, SLOT(abort()));
 
+    progressBar = new QProgressBar;
+    progressBar->setVisible(false);
+
     QHBoxLayout *topLayout = new QHBoxLayout;
     topLayout->addWidget(opLabel);
 
@@ -34,10 +37,18 @@ ProgressDialog::ProgressDialog(QWidget *parent) : QDialog(parent) {
 
     QVBoxLayout *mainLayout = new QVBoxLayout;
     mainLayout->addLayout(topLayout);
+    mainLayout->addWidget(progressBar);
     mainLayout->addLayout(buttonsLayout, Qt::AlignRight);
     setLayout(mainLayout);
 }
 
 void ProgressDialog::abort() {
     abortOp = true;
+    emit aborted();
+}
+
+void ProgressDialog::setProgress(int value, int maximum) {
+    progressBar->setVisible(true);
+    progressBar->setMaximum(maximum);
+    progressBar->setValue(value);
 }
@@ -31,6 +31,12 @@ public slots:
 
     void abort();
 
+    void setProgress(int value, int maximum);
+
+signals:
+
+    void aborted();
+
 public:
     QLabel *opLabel;
     bool abortOp;
@@ -39,6 +45,7 @@ public:
 
 private:
     QPushButton *cancelButton;
+    QProgressBar *progressBar;
 };
 
 #endif // PROGRESS_DIALOG_H
@@ -250,6 +250,10 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent) {
     setWindowIconCheckBox = new QCheckBox(tr("Set the application icon according to the current image"), this);
     setWindowIconCheckBox->setChecked(Settings::setWindowIcon);
 
+    // Tags in sidecar files
+    tagsSidecarCheckBox = new QCheckBox(tr("Save tags to XMP sidecar files instead of the images"), this);
+    tagsSidecarCheckBox->setChecked(Settings::tagsSidecarEnabled);
+
     QVBoxLayout *generalSettingsLayout = new QVBoxLayout;
     generalSettingsLayout->addWidget(reverseMouseCheckBox);
     generalSettingsLayout->addWidget(deleteConfirmCheckBox);
@@ -279,6 +283,7 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent) {
     slideshowGroupBox->setLayout(slideshowLayout);
     generalSettingsLayout->addWidget(slideshowGroupBox);
     generalSettingsLayout->addWidget(setWindowIconCheckBox);
+    generalSettingsLayout->addWidget(tagsSidecarCheckBox);
     generalSettingsLayout->addStretch(1);
 
     /* Confirmation buttons */
@@ -353,6 +358,7 @@ void SettingsDialog::saveSettings() {
     Settings::reverseMouseBehavior = reverseMouseCheckBox->isChecked();
     Settings::deleteConfirm = deleteConfirmCheckBox->isChecked();
     Settings::setWindowIcon = setWindowIconCheckBox->isChecked();
+    Settings::tagsSidecarEnabled = tagsSidecarCheckBox->isChecked();
 
     if (startupDirectoryRadioButtons[Settings::RememberLastDir]->isChecked()) {
         Settings::startupDir = Settings::RememberLastDir;
@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TagDictionary.h"
+
+QReadWriteLock TagDictionary::lock;
+QHash<QString, int> TagDictionary::tagIds;
+QVector<QString> TagDictionary::tagNames;
+
+int TagDictionary::intern(const QString &tagName) {
+    {
+        QReadLocker readLocker(&lock);
+        QHash<QString, int>::const_iterator it = tagIds.constFind(tagName);
+        if (it != tagIds.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker writeLocker(&lock);
+    QHash<QString, int>::const_iterator it = tagIds.constFind(tagName);
+    if (it != tagIds.constEnd()) {
+        return it.value();
+    }
+
+    int tagId = tagNames.size();
+    tagNames.append(tagName);
+    tagIds.insert(tagName, tagId);
+    return tagId;
+}
+
+int TagDictionary::find(const QString &tagName) {
+    QReadLocker readLocker(&lock);
+    return tagIds.value(tagName, -1);
+}
+
+QString TagDictionary::name(int tagId) {
+    QReadLocker readLocker(&lock);
+    return tagNames.value(tagId);
+}
+
+int TagDictionary::count() {
+    QReadLocker readLocker(&lock);
+    return tagNames.size();
+}
+
+QBitArray TagDictionary::toTagIds(const QSet<QString> &tagNames) {
+    QBitArray tagIds;
+
+    QSetIterator<QString> tagNamesIt(tagNames);
+    while (tagNamesIt.hasNext()) {
+        int tagId = intern(tagNamesIt.next());
+        if (tagId >= tagIds.size()) {
+            tagIds.resize(tagId + 1);
+        }
+        tagIds.setBit(tagId);
+    }
+
+    return tagIds;
+}
+
+QSet<QString> TagDictionary::toTagNames(const QBitArray &tagIds) {
+    QSet<QString> names;
+
+    QReadLocker readLocker(&lock);
+    for (int tagId = 0; tagId < tagIds.size(); ++tagId) {
+        if (tagIds.testBit(tagId)) {
+            names.insert(tagNames.at(tagId));
+        }
+    }
+
+    return names;
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TAG_DICTIONARY_H
+#define TAG_DICTIONARY_H
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QBitArray>
+#include <QSet>
+#include <QReadWriteLock>
+
+/*
+ * Process wide table of tag names. Every distinct tag name is stored once and
+ * referred to by a small integer id, so per image tag sets can be kept as bit arrays.
+ * Ids are never reused or removed.
+ */
+class TagDictionary {
+
+public:
+    static int intern(const QString &tagName);
+
+    static int find(const QString &tagName);
+
+    static QString name(int tagId);
+
+    static int count();
+
+    static QBitArray toTagIds(const QSet<QString> &tagNames);
+
+    static QSet<QString> toTagNames(const QBitArray &tagIds);
+
+private:
+    static QReadWriteLock lock;
+    static QHash<QString, int> tagIds;
+    static QVector<QString> tagNames;
+};
+
+#endif // TAG_DICTIONARY_H
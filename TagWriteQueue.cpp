@@ -0,0 +1,257 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <exiv2/exiv2.hpp>
+#include "TagWriteQueue.h"
+#include "XmpSidecar.h"
+#include "Settings.h"
+
+class TagWriteTask : public QRunnable {
+
+public:
+    TagWriteTask(TagWriteQueue *tagWriteQueue, const QString &imageFileName) {
+        this->tagWriteQueue = tagWriteQueue;
+        this->imageFileName = imageFileName;
+    }
+
+    void run() {
+        QSet<QString> tags;
+
+        /* Keep writing while newer tags keep arriving for the same file */
+        while (tagWriteQueue->takePendingTags(imageFileName, tags)) {
+            tagWriteQueue->setWriteResult(imageFileName, TagWriteQueue::writeTagsToImage(imageFileName, tags));
+        }
+
+        QMetaObject::invokeMethod(tagWriteQueue, "checkDone", Qt::QueuedConnection);
+    }
+
+private:
+    TagWriteQueue *tagWriteQueue;
+    QString imageFileName;
+};
+
+TagWriteQueue::TagWriteQueue(QObject *parent) : QObject(parent) {
+    threadPool.setMaxThreadCount(TAG_WRITE_THREADS);
+
+    /* Exiv2 requires the XMP toolkit to be initialized before it is used from several threads */
+    Exiv2::XmpParser::initialize();
+
+    journalDirectory = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/phototonic";
+    QDir().mkpath(journalDirectory);
+
+    /* Named after this process and its start, the lock tells other instances it is still in use */
+    QString journalName = QDir(journalDirectory).filePath(
+            QString("pending_tags.%1-%2").arg(QCoreApplication::applicationPid())
+                    .arg(QDateTime::currentMSecsSinceEpoch()));
+    journalLock = new QLockFile(journalName + ".lock");
+    journalLock->setStaleLockTime(0);
+    if (!journalLock->tryLock(0)) {
+        qWarning() << "Failed to lock tags journal" << journalLock->error();
+    }
+    journal.setFileName(journalName + ".journal");
+}
+
+TagWriteQueue::~TagWriteQueue() {
+    waitForDone();
+    delete journalLock;
+}
+
+void TagWriteQueue::enqueue(const QString &imageFileName, const QSet<QString> &tags) {
+    appendToJournal(imageFileName, tags);
+
+    QMutexLocker locker(&mutex);
+    pendingTags.insert(imageFileName, tags);
+    if (!scheduledImages.contains(imageFileName)) {
+        scheduledImages.insert(imageFileName);
+        threadPool.start(new TagWriteTask(this, imageFileName));
+    }
+}
+
+bool TagWriteQueue::takePendingTags(const QString &imageFileName, QSet<QString> &tags) {
+    QMutexLocker locker(&mutex);
+    if (!pendingTags.contains(imageFileName)) {
+        scheduledImages.remove(imageFileName);
+        return false;
+    }
+
+    tags = pendingTags.take(imageFileName);
+    return true;
+}
+
+void TagWriteQueue::setWriteResult(const QString &imageFileName, bool success) {
+    QMutexLocker locker(&mutex);
+    if (success) {
+        failedImages.removeAll(imageFileName);
+    } else if (!failedImages.contains(imageFileName)) {
+        failedImages.append(imageFileName);
+    }
+}
+
+bool TagWriteQueue::isIdle() {
+    QMutexLocker locker(&mutex);
+    return pendingTags.isEmpty() && scheduledImages.isEmpty();
+}
+
+void TagWriteQueue::waitForDone() {
+    threadPool.waitForDone();
+    checkDone();
+}
+
+/* Once everything was written the journal is dropped and failures are reported together */
+void TagWriteQueue::checkDone() {
+    QStringList failed;
+
+    {
+        QMutexLocker locker(&mutex);
+        if (!pendingTags.isEmpty() || !scheduledImages.isEmpty()) {
+            return;
+        }
+
+        failed = failedImages;
+        failedImages.clear();
+    }
+
+    journal.close();
+    journal.remove();
+
+    if (failed.size()) {
+        emit writeFailed(failed);
+    }
+}
+
+void TagWriteQueue::appendToJournal(const QString &imageFileName, const QSet<QString> &tags) {
+    if (!journal.isOpen() && !journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open tags journal" << journal.fileName();
+        return;
+    }
+
+    QJsonObject entry;
+    entry.insert("file", imageFileName);
+    entry.insert("tags", QJsonArray::fromStringList(tags.toList()));
+
+    journal.write(QJsonDocument(entry).toJson(QJsonDocument::Compact) + '\n');
+    journal.flush();
+}
+
+/* Replays the journals of instances that exited before writing everything, oldest first */
+void TagWriteQueue::replayJournal() {
+    QDir journalDir(journalDirectory);
+    QStringList journalNames = journalDir.entryList(QStringList() << "pending_tags.*.journal", QDir::Files,
+                                                    QDir::Time | QDir::Reversed);
+
+    /* Later entries for the same file replace earlier ones */
+    QList<QString> imageFileNames;
+    QHash<QString, QSet<QString> > journaledTags;
+    for (int journalIndex = 0; journalIndex < journalNames.size(); ++journalIndex) {
+        QString journalFileName = journalDir.filePath(journalNames.at(journalIndex));
+        if (journalFileName == journal.fileName()) {
+            continue;
+        }
+
+        /* A running instance holds the lock of its journal, the lock of an exited one is stale whatever its age */
+        QLockFile journalFileLock(journalFileName.left(journalFileName.size() - QString(".journal").size())
+                                  + ".lock");
+        journalFileLock.setStaleLockTime(0);
+        if (!journalFileLock.tryLock(0)) {
+            continue;
+        }
+
+        QFile journalFile(journalFileName);
+        if (!journalFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        while (!journalFile.atEnd()) {
+            QJsonObject entry = QJsonDocument::fromJson(journalFile.readLine()).object();
+            QString imageFileName = entry.value("file").toString();
+            if (imageFileName.isEmpty()) {
+                continue;
+            }
+
+            QSet<QString> tags;
+            QJsonArray tagsArray = entry.value("tags").toArray();
+            for (int i = 0; i < tagsArray.size(); ++i) {
+                tags.insert(tagsArray.at(i).toString());
+            }
+
+            if (!journaledTags.contains(imageFileName)) {
+                imageFileNames.append(imageFileName);
+            }
+            journaledTags.insert(imageFileName, tags);
+        }
+        journalFile.close();
+        journalFile.remove();
+    }
+
+    for (int i = 0; i < imageFileNames.size(); ++i) {
+        enqueue(imageFileNames.at(i), journaledTags.value(imageFileNames.at(i)));
+    }
+}
+
+bool TagWriteQueue::writeTagsToImage(const QString &imageFileName, const QSet<QString> &tags) {
+    if (Settings::tagsSidecarEnabled) {
+        return XmpSidecar::writeTags(imageFileName, tags);
+    }
+
+    Exiv2::Image::AutoPtr exifImage;
+
+    try {
+        exifImage = Exiv2::ImageFactory::open(imageFileName.toStdString());
+        exifImage->readMetadata();
+
+        Exiv2::IptcData newIptcData;
+
+        /* copy existing data */
+        Exiv2::IptcData &iptcData = exifImage->iptcData();
+        if (!iptcData.empty()) {
+            Exiv2::IptcData::iterator end = iptcData.end();
+            for (Exiv2::IptcData::iterator iptcIt = iptcData.begin(); iptcIt != end; ++iptcIt) {
+                if (iptcIt->tagName() != "Keywords") {
+                    newIptcData.add(*iptcIt);
+                }
+            }
+        }
+
+        /* add new tags */
+        QSetIterator<QString> tagsIt(tags);
+        while (tagsIt.hasNext()) {
+            QString tag = tagsIt.next();
+            Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::string);
+            value->read(tag.toStdString());
+            Exiv2::IptcKey key("Iptc.Application2.Keywords");
+            newIptcData.add(key, value.get());
+        }
+
+        exifImage->setIptcData(newIptcData);
+        exifImage->writeMetadata();
+    }
+    catch (Exiv2::Error &error) {
+        return false;
+    }
+
+    return true;
+}
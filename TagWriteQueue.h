@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TAG_WRITE_QUEUE_H
+#define TAG_WRITE_QUEUE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QFile>
+#include <QLockFile>
+#include <QStringList>
+
+#define TAG_WRITE_THREADS 2
+
+/*
+ * Writes image tags in the background. Changes to the same file that arrive before
+ * it is written are merged, so every file is rewritten once with its latest tags.
+ * Pending changes are journaled to disk and replayed on the next start if the
+ * application did not get to write them. Every running instance keeps its own
+ * journal, locked while it runs, so only journals of exited instances are replayed.
+ */
+class TagWriteQueue : public QObject {
+Q_OBJECT
+
+public:
+    TagWriteQueue(QObject *parent);
+
+    ~TagWriteQueue();
+
+    void enqueue(const QString &imageFileName, const QSet<QString> &tags);
+
+    void replayJournal();
+
+    void waitForDone();
+
+    bool isIdle();
+
+    static bool writeTagsToImage(const QString &imageFileName, const QSet<QString> &tags);
+
+signals:
+
+    void writeFailed(QStringList failedImages);
+
+private:
+    friend class TagWriteTask;
+
+    QThreadPool threadPool;
+    QMutex mutex;
+    QHash<QString, QSet<QString> > pendingTags;
+    QSet<QString> scheduledImages;
+    QStringList failedImages;
+    QString journalDirectory;
+    QFile journal;
+    QLockFile *journalLock;
+
+    bool takePendingTags(const QString &imageFileName, QSet<QString> &tags);
+
+    void setWriteResult(const QString &imageFileName, bool success);
+
+    void appendToJournal(const QString &imageFileName, const QSet<QString> &tags);
+
+private slots:
+
+    void checkDone();
+};
+
+#endif // TAG_WRITE_QUEUE_H
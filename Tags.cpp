@@ -18,7 +18,6 @@
 
 #include "Tags.h"
 #include "Settings.h"
-#include "ProgressDialog.h"
 #include "MessageBox.h"
 
 ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache *metadataCache) : QWidget(parent) {
@@ -31,6 +30,11 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     this->thumbView = thumbsViewer;
     this->metadataCache = metadataCache;
     negateFilterEnabled = false;
+    matchAllFilterEnabled = false;
+
+    tagWriteQueue = new TagWriteQueue(this);
+    connect(tagWriteQueue, SIGNAL(writeFailed(QStringList)), this, SLOT(onTagsWriteFailed(QStringList)));
+    tagWriteQueue->replayJournal();
 
     tabs = new QTabBar(this);
     tabs->addTab(tr("Selection"));
@@ -79,6 +83,10 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     negateAction->setCheckable(true);
     connect(negateAction, SIGNAL(triggered()), this, SLOT(negateFilter()));
 
+    matchAllAction = new QAction(tr("Match All"), this);
+    matchAllAction->setCheckable(true);
+    connect(matchAllAction, SIGNAL(triggered()), this, SLOT(matchAllFilter()));
+
     tagsMenu = new QMenu("");
     tagsMenu->addAction(addToSelectionAction);
     tagsMenu->addAction(removeFromSelectionAction);
@@ -88,6 +96,7 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     tagsMenu->addSeparator();
     tagsMenu->addAction(actionClearTagsFilter);
     tagsMenu->addAction(negateAction);
+    tagsMenu->addAction(matchAllAction);
 }
 
 void ImageTags::redrawTagTree() {
@@ -134,50 +143,6 @@ void ImageTags::addTag(QString tagName, bool tagChecked) {
     tagsTree->addTopLevelItem(tagItem);
 }
 
-bool ImageTags::writeTagsToImage(QString &imageFileName, QSet<QString> &newTags) {
-    QSet<QString> imageTags;
-    Exiv2::Image::AutoPtr exifImage;
-
-    try {
-        exifImage = Exiv2::ImageFactory::open(imageFileName.toStdString());
-        exifImage->readMetadata();
-
-        Exiv2::IptcData newIptcData;
-
-        /* copy existing data */
-        Exiv2::IptcData &iptcData = exifImage->iptcData();
-        if (!iptcData.empty()) {
-            QString key;
-            Exiv2::IptcData::iterator end = iptcData.end();
-            for (Exiv2::IptcData::iterator iptcIt = iptcData.begin(); iptcIt != end; ++iptcIt) {
-                if (iptcIt->tagName() != "Keywords") {
-                    newIptcData.add(*iptcIt);
-                }
-            }
-        }
-
-        /* add new tags */
-        QSetIterator<QString> newTagsIt(newTags);
-        while (newTagsIt.hasNext()) {
-            QString tag = newTagsIt.next();
-            Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::string);
-            value->read(tag.toStdString());
-            Exiv2::IptcKey key("Iptc.Application2.Keywords");
-            newIptcData.add(key, value.get());
-        }
-
-        exifImage->setIptcData(newIptcData);
-        exifImage->writeMetadata();
-    }
-    catch (Exiv2::Error &error) {
-        MessageBox msgBox(this);
-        msgBox.critical(tr("Error"), tr("Failed to save tags to ") + imageFileName);
-        return false;
-    }
-
-    return true;
-}
-
 void ImageTags::showSelectedImagesTags() {
     static bool busy = false;
     if (busy)
@@ -188,13 +153,20 @@ void ImageTags::showSelectedImagesTags() {
     setActiveViewMode(SelectionTagsDisplay);
 
     int selectedThumbsNum = selectedThumbs.size();
-    QMap<QString, int> tagsCount;
+    QVector<int> tagsCount(TagDictionary::count());
     for (int i = 0; i < selectedThumbsNum; ++i) {
-        QSetIterator<QString> imageTagsIter(metadataCache->getImageTags(selectedThumbs[i]));
-        while (imageTagsIter.hasNext()) {
-            QString imageTag = imageTagsIter.next();
-            tagsCount[imageTag]++;
+        QBitArray imageTagIds = metadataCache->getImageTagIds(selectedThumbs[i]);
+        for (int tagId = 0; tagId < imageTagIds.size(); ++tagId) {
+            if (!imageTagIds.testBit(tagId)) {
+                continue;
+            }
 
+            if (tagId >= tagsCount.size()) {
+                tagsCount.resize(tagId + 1);
+            }
+            tagsCount[tagId]++;
+
+            QString imageTag = TagDictionary::name(tagId);
             if (!Settings::knownTags.contains(imageTag)) {
                 addTag(imageTag, true);
                 Settings::knownTags.insert(imageTag);
@@ -205,8 +177,8 @@ void ImageTags::showSelectedImagesTags() {
     bool imagesTagged = false, imagesTaggedMixed = false;
     QTreeWidgetItemIterator it(tagsTree);
     while (*it) {
-        QString tagName = (*it)->text(0);
-        int tagCountTotal = tagsCount[tagName];
+        int tagId = TagDictionary::find((*it)->text(0));
+        int tagCountTotal = (tagId >= 0 && tagId < tagsCount.size()) ? tagsCount.at(tagId) : 0;
 
         if (selectedThumbsNum == 0) {
             (*it)->setCheckState(0, Qt::Unchecked);
@@ -297,19 +269,21 @@ void ImageTags::setActiveViewMode(TagsDisplayMode mode) {
     removeFromSelectionAction->setVisible(currentDisplayMode == SelectionTagsDisplay);
     actionClearTagsFilter->setVisible(currentDisplayMode == DirectoryTagsDisplay);
     negateAction->setVisible(currentDisplayMode == DirectoryTagsDisplay);
+    matchAllAction->setVisible(currentDisplayMode == DirectoryTagsDisplay);
 }
 
 bool ImageTags::isImageFilteredOut(QString imageFileName) {
-    QSet<QString> imageTags = metadataCache->getImageTags(imageFileName);
+    QBitArray matchingTagIds = metadataCache->getImageTagIds(imageFileName) & imageFilteringTagIds;
+    int matchingTagsCount = matchingTagIds.count(true);
 
-    QSetIterator<QString> filteredTagsIt(imageFilteringTags);
-    while (filteredTagsIt.hasNext()) {
-        if (imageTags.contains(filteredTagsIt.next())) {
-            return negateFilterEnabled;
-        }
+    bool matching;
+    if (matchAllFilterEnabled) {
+        matching = (matchingTagsCount == imageFilteringTagIds.count(true));
+    } else {
+        matching = (matchingTagsCount > 0);
     }
 
-    return !negateFilterEnabled;
+    return matching == negateFilterEnabled;
 }
 
 void ImageTags::resetTagsState() {
@@ -333,6 +307,7 @@ QSet<QString> ImageTags::getCheckedTags(Qt::CheckState tagState) {
 
 void ImageTags::applyTagFiltering() {
     imageFilteringTags = getCheckedTags(Qt::Checked);
+    imageFilteringTagIds = TagDictionary::toTagIds(imageFilteringTags);
     if (imageFilteringTags.size()) {
         dirFilteringActive = true;
         if (negateFilterEnabled) {
@@ -345,7 +320,27 @@ void ImageTags::applyTagFiltering() {
         tabs->setTabIcon(1, QIcon(":/images/tag_filter_off.png"));
     }
 
-    emit reloadThumbs();
+    /* Hide and show the rows already in the view using the inverted tags index */
+    QBitArray matchingImages;
+    if (dirFilteringActive) {
+        matchingImages = metadataCache->getTaggedImages(imageFilteringTagIds, matchAllFilterEnabled);
+    }
+
+    for (int row = 0; row < thumbView->thumbsViewerModel->rowCount(); ++row) {
+        bool filteredOut = false;
+
+        if (dirFilteringActive) {
+            QString imageFileName = thumbView->thumbsViewerModel->item(row)->data(
+                    ThumbsViewer::FileNameRole).toString();
+            int imageId = metadataCache->getImageId(imageFileName);
+            bool matching = imageId >= 0 && imageId < matchingImages.size() && matchingImages.testBit(imageId);
+            filteredOut = (matching == negateFilterEnabled);
+        }
+
+        thumbView->setThumbHidden(row, filteredOut);
+    }
+
+    thumbView->thumbsFilterChanged();
 }
 
 void ImageTags::applyUserAction(QTreeWidgetItem *item) {
@@ -355,45 +350,45 @@ void ImageTags::applyUserAction(QTreeWidgetItem *item) {
 }
 
 void ImageTags::applyUserAction(QList<QTreeWidgetItem *> tagsList) {
-    int processEventsCounter = 0;
-    ProgressDialog *progressDialog = new ProgressDialog(this);
-    progressDialog->show();
-
     QStringList currentSelectedImages = thumbView->getSelectedThumbsList();
+
+    for (int i = tagsList.size() - 1; i > -1; --i) {
+        Qt::CheckState tagState = tagsList.at(i)->checkState(0);
+        setTagIcon(tagsList.at(i), (tagState == Qt::Checked ? TagIconEnabled : TagIconDisabled));
+    }
+
     for (int currentImage = 0; currentImage < currentSelectedImages.size(); ++currentImage) {
 
         QString imageName = currentSelectedImages[currentImage];
         for (int i = tagsList.size() - 1; i > -1; --i) {
-            Qt::CheckState tagState = tagsList.at(i)->checkState(0);
-            setTagIcon(tagsList.at(i), (tagState == Qt::Checked ? TagIconEnabled : TagIconDisabled));
-            QString tagName = tagsList.at(i)->text(0);
+            int tagId = TagDictionary::intern(tagsList.at(i)->text(0));
 
-            if (tagState == Qt::Checked) {
-                progressDialog->opLabel->setText(tr("Tagging ") + imageName);
-                metadataCache->addTagToImage(imageName, tagName);
+            if (tagsList.at(i)->checkState(0) == Qt::Checked) {
+                metadataCache->addTagToImage(imageName, tagId);
             } else {
-                progressDialog->opLabel->setText(tr("Untagging ") + imageName);
-                metadataCache->removeTagFromImage(imageName, tagName);
+                metadataCache->removeTagFromImage(imageName, tagId);
             }
         }
 
-        if (!writeTagsToImage(imageName, metadataCache->getImageTags(imageName))) {
-            metadataCache->removeImage(imageName);
-        }
+        /* The cache is updated right away, the files are written in the background */
+        tagWriteQueue->enqueue(imageName, metadataCache->getImageTags(imageName));
+    }
+}
 
-        ++processEventsCounter;
-        if (processEventsCounter > 9) {
-            processEventsCounter = 0;
-            QApplication::processEvents();
-        }
+void ImageTags::onTagsWriteFailed(QStringList failedImages) {
+    /* Reread what is actually in the files */
+    for (int i = 0; i < failedImages.size(); ++i) {
+        metadataCache->removeImage(failedImages[i]);
+        metadataCache->loadImageMetadata(failedImages.at(i));
+    }
 
-        if (progressDialog->abortOp) {
-            break;
-        }
+    if (currentDisplayMode == SelectionTagsDisplay) {
+        showSelectedImagesTags();
     }
 
-    progressDialog->close();
-    delete (progressDialog);
+    MessageBox msgBox(this);
+    msgBox.setDetailedText(failedImages.join("\n"));
+    msgBox.critical(tr("Error"), tr("Failed to save tags to %n image(s)", "", failedImages.size()));
 }
 
 void ImageTags::saveLastChangedTag(QTreeWidgetItem *item, int) {
@@ -451,6 +446,11 @@ void ImageTags::negateFilter() {
     applyTagFiltering();
 }
 
+void ImageTags::matchAllFilter() {
+    matchAllFilterEnabled = matchAllAction->isChecked();
+    applyTagFiltering();
+}
+
 void ImageTags::addNewTag() {
     bool ok;
     QString title = tr("Add a new tag");
@@ -477,7 +477,7 @@ void ImageTags::addNewTag() {
     }
 
     addTag(newTagName, false);
-    Settings::knownTags.insert(newTagName);
+    Settings::knownTags.insert(TagDictionary::name(TagDictionary::intern(newTagName)));
     redrawTagTree();
 }
 
@@ -23,6 +23,7 @@
 #include <exiv2/exiv2.hpp>
 #include "ThumbsViewer.h"
 #include "MetadataCache.h"
+#include "TagWriteQueue.h"
 
 class ThumbsViewer;
 
@@ -65,10 +66,9 @@ public:
     bool dirFilteringActive;
     QAction *removeTagAction;
     TagsDisplayMode currentDisplayMode;
+    TagWriteQueue *tagWriteQueue;
 
 private:
-    bool writeTagsToImage(QString &imageFileName, QSet<QString> &tags);
-
     QSet<QString> getCheckedTags(Qt::CheckState tagState);
 
     void setTagIcon(QTreeWidgetItem *tagItem, TagIcons icon);
@@ -82,16 +82,19 @@ private:
     void redrawTagTree();
 
     QSet<QString> imageFilteringTags;
+    QBitArray imageFilteringTagIds;
     QAction *actionAddTag;
     QAction *addToSelectionAction;
     QAction *removeFromSelectionAction;
     QAction *actionClearTagsFilter;
     QAction *negateAction;
+    QAction *matchAllAction;
     QTreeWidgetItem *lastChangedTagItem;
     ThumbsViewer *thumbView;
     QTabBar *tabs;
     MetadataCache *metadataCache;
     bool negateFilterEnabled;
+    bool matchAllFilterEnabled;
 
 private slots:
 
@@ -111,13 +114,13 @@ private slots:
 
     void negateFilter();
 
+    void matchAllFilter();
+
     void removeTagsFromSelection();
 
     void tabsChanged(int index);
 
-signals:
-
-    void reloadThumbs();
+    void onTagsWriteFailed(QStringList failedImages);
 
 };
 
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include "ThumbnailCache.h"
+#include "MetadataCache.h"
+#include "OrientationKernel.h"
+
+int ThumbnailCache::getCacheSize(int thumbSize) {
+    if (thumbSize <= THUMBNAIL_CACHE_NORMAL_SIZE) {
+        return THUMBNAIL_CACHE_NORMAL_SIZE;
+    }
+    if (thumbSize <= THUMBNAIL_CACHE_LARGE_SIZE) {
+        return THUMBNAIL_CACHE_LARGE_SIZE;
+    }
+    return 0;
+}
+
+/* Named by the MD5 of the file URI, as the thumbnail specification asks */
+QString ThumbnailCache::getThumbnailPath(const QString &imageFileName, int cacheSize) {
+    QByteArray uri = QUrl::fromLocalFile(QFileInfo(imageFileName).absoluteFilePath()).toEncoded();
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex());
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails/"
+           + (cacheSize == THUMBNAIL_CACHE_LARGE_SIZE ? "large/" : "normal/") + hash + ".png";
+}
+
+QString ThumbnailCache::getModificationTime(const QString &imageFileName) {
+    return QString::number(QFileInfo(imageFileName).lastModified().toMSecsSinceEpoch() / 1000);
+}
+
+bool ThumbnailCache::load(const QString &imageFileName, int cacheSize, QImage &thumbnail) {
+    QImageReader thumbnailReader(getThumbnailPath(imageFileName, cacheSize), "png");
+
+    /* The text chunks come before the image data, a stale thumbnail is never decoded */
+    if (thumbnailReader.text("Thumb::MTime") != getModificationTime(imageFileName)) {
+        return false;
+    }
+
+    return thumbnailReader.read(&thumbnail);
+}
+
+bool ThumbnailCache::create(const QString &imageFileName, int cacheSize, QImage &thumbnail, QString &errorString) {
+    QImageReader imageReader(imageFileName);
+    QSize imageSize = imageReader.size();
+    if (!imageSize.isValid()) {
+        errorString = imageReader.errorString();
+        return false;
+    }
+
+    QSize thumbnailSize = imageSize;
+    if (thumbnailSize.width() > cacheSize || thumbnailSize.height() > cacheSize) {
+        thumbnailSize.scale(QSize(cacheSize, cacheSize), Qt::KeepAspectRatio);
+    }
+    imageReader.setScaledSize(thumbnailSize);
+    if (!imageReader.read(&thumbnail)) {
+        errorString = imageReader.errorString();
+        return false;
+    }
+    thumbnail = OrientationKernel::apply(thumbnail, MetadataCache::readImageOrientation(imageFileName));
+
+    QString thumbnailPath = getThumbnailPath(imageFileName, cacheSize);
+    if (!QDir().mkpath(QFileInfo(thumbnailPath).absolutePath())) {
+        errorString = "Cannot create the thumbnail directory";
+        return false;
+    }
+
+    QSaveFile thumbnailFile(thumbnailPath);
+    if (!thumbnailFile.open(QIODevice::WriteOnly)) {
+        errorString = thumbnailFile.errorString();
+        return false;
+    }
+
+    QImageWriter thumbnailWriter(&thumbnailFile, "png");
+    thumbnailWriter.setText("Thumb::URI", QString::fromLatin1(
+            QUrl::fromLocalFile(QFileInfo(imageFileName).absoluteFilePath()).toEncoded()));
+    thumbnailWriter.setText("Thumb::MTime", getModificationTime(imageFileName));
+    thumbnailWriter.setText("Thumb::Size", QString::number(QFileInfo(imageFileName).size()));
+    thumbnailWriter.setText("Thumb::Image::Width", QString::number(imageSize.width()));
+    thumbnailWriter.setText("Thumb::Image::Height", QString::number(imageSize.height()));
+    thumbnailWriter.setText("Software", "Phototonic");
+    if (!thumbnailWriter.write(thumbnail)) {
+        errorString = thumbnailWriter.errorString();
+        return false;
+    }
+    if (!thumbnailFile.commit()) {
+        errorString = thumbnailFile.errorString();
+        return false;
+    }
+
+    /* Thumbnails may reveal private images, they are for the owner only */
+    QFile::setPermissions(thumbnailPath, QFile::ReadOwner | QFile::WriteOwner);
+    return true;
+}
+
+bool ThumbnailCache::read(const QString &imageFileName, int thumbSize, long orientation, QImage &thumbnail,
+                          bool &cached, bool cacheEnabled) {
+    thumbnail = QImage();
+    cached = false;
+    int cacheSize = getCacheSize(thumbSize);
+    if (cacheEnabled && cacheSize && load(imageFileName, cacheSize, thumbnail)) {
+        cached = true;
+        if (thumbnail.width() > thumbSize || thumbnail.height() > thumbSize) {
+            thumbnail = thumbnail.scaled(thumbSize, thumbSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        return true;
+    }
+
+    QImageReader imageReader(imageFileName);
+    QSize thumbnailSize = imageReader.size();
+    if (!thumbnailSize.isValid()) {
+        return false;
+    }
+
+    if (thumbnailSize.width() > thumbSize || thumbnailSize.height() > thumbSize) {
+        thumbnailSize.scale(QSize(thumbSize, thumbSize), Qt::KeepAspectRatio);
+    }
+    imageReader.setScaledSize(thumbnailSize);
+    if (!imageReader.read(&thumbnail)) {
+        return false;
+    }
+
+    thumbnail = OrientationKernel::apply(thumbnail, orientation);
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAIL_CACHE_H
+#define THUMBNAIL_CACHE_H
+
+#include <QImage>
+#include <QString>
+
+#define THUMBNAIL_CACHE_NORMAL_SIZE 128
+#define THUMBNAIL_CACHE_LARGE_SIZE 256
+
+/*
+ * Thumbnails kept on disk in the freedesktop.org shared thumbnail cache, so they
+ * survive restarts, are shared with file managers and can be generated ahead of time
+ * from the command line. A thumbnail is only used while its recorded modification
+ * time matches the file. Thumbnails are stored upright, with the Exif orientation of
+ * the image applied. All functions are thread safe.
+ */
+class ThumbnailCache {
+
+public:
+    /* The cache size that holds thumbnails of the given size, 0 when they are too large to be cached */
+    static int getCacheSize(int thumbSize);
+
+    static bool load(const QString &imageFileName, int cacheSize, QImage &thumbnail);
+
+    /* Decodes and stores a thumbnail, thumbnail is set even when only storing it failed */
+    static bool create(const QString &imageFileName, int cacheSize, QImage &thumbnail, QString &errorString);
+
+    /*
+     * A thumbnail no larger than thumbSize, from the cache when it has a current one, otherwise
+     * decoded from the image and turned upright by orientation. Never writes to the cache,
+     * cached is false when the thumbnail is worth storing with create(). Without cacheEnabled
+     * the cache is skipped, for thumbnails that must not be upright.
+     */
+    static bool read(const QString &imageFileName, int thumbSize, long orientation, QImage &thumbnail,
+                     bool &cached, bool cacheEnabled = true);
+
+private:
+    static QString getThumbnailPath(const QString &imageFileName, int cacheSize);
+
+    static QString getModificationTime(const QString &imageFileName);
+};
+
+#endif // THUMBNAIL_CACHE_H
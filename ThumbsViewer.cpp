@@ -16,9 +16,36 @@
  *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <random>
+#include <algorithm>
+#include <QThreadPool>
+#include <QRunnable>
 #include "ThumbsViewer.h"
+#include "ThumbnailCache.h"
 #include "Phototonic.h"
 
+Q_GLOBAL_STATIC(QThreadPool, thumbnailCacheThreadPool)
+
+/* Decodes the image again at cache size and stores it, off the GUI thread */
+class ThumbnailCacheTask : public QRunnable {
+
+public:
+    ThumbnailCacheTask(const QString &imageFileName, int cacheSize) {
+        this->imageFileName = imageFileName;
+        this->cacheSize = cacheSize;
+    }
+
+    void run() {
+        QImage thumbnail;
+        QString errorString;
+        ThumbnailCache::create(imageFileName, cacheSize, thumbnail, errorString);
+    }
+
+private:
+    QString imageFileName;
+    int cacheSize;
+};
+
 ThumbsViewer::ThumbsViewer(QWidget *parent, MetadataCache *metadataCache) : QListView(parent) {
     this->metadataCache = metadataCache;
     Settings::thumbsBackgroundColor = Settings::appSettings->value(
@@ -28,6 +55,10 @@ ThumbsViewer::ThumbsViewer(QWidget *parent, MetadataCache *metadataCache) : QLis
     Settings::thumbsPagesReadCount = Settings::appSettings->value(Settings::optionThumbsPagesReadCount).toUInt();
     thumbSize = Settings::appSettings->value(Settings::optionThumbsZoomLevel).toInt();
     currentRow = 0;
+    hiddenThumbsCount = 0;
+
+    /* Storing thumbnails is background work, it should not compete with decoding the visible ones */
+    thumbnailCacheThreadPool()->setMaxThreadCount(1);
 
     setViewMode(QListView::IconMode);
     setSelectionMode(QAbstractItemView::ExtendedSelection);
@@ -94,28 +125,175 @@ QString ThumbsViewer::getSingleSelectionFilename() {
     return ("");
 }
 
+/* Rows hidden by the tags filter are skipped by all row navigation */
 int ThumbsViewer::getNextRow() {
-    if (currentRow == thumbsViewerModel->rowCount() - 1) {
-        return -1;
+    for (int row = currentRow + 1; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
     }
 
-    return currentRow + 1;
+    return -1;
 }
 
 int ThumbsViewer::getPrevRow() {
-    if (currentRow == 0) {
-        return -1;
+    for (int row = currentRow - 1; row >= 0; --row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
+    }
+
+    return -1;
+}
+
+int ThumbsViewer::getFirstRow() {
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
     }
 
-    return currentRow - 1;
+    return -1;
 }
 
 int ThumbsViewer::getLastRow() {
-    return thumbsViewerModel->rowCount() - 1;
+    for (int row = thumbsViewerModel->rowCount() - 1; row >= 0; --row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
+    }
+
+    return -1;
 }
 
 int ThumbsViewer::getRandomRow() {
-    return qrand() % (thumbsViewerModel->rowCount());
+    int visibleThumbsCount = getVisibleThumbsCount();
+    if (visibleThumbsCount <= 0) {
+        return -1;
+    }
+
+    int visibleIndex = qrand() % visibleThumbsCount;
+    if (!hiddenThumbsCount) {
+        return visibleIndex;
+    }
+
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row) && visibleIndex-- == 0) {
+            return row;
+        }
+    }
+
+    return -1;
+}
+
+/* The images following (or preceding) the current one in viewing order */
+QStringList ThumbsViewer::getAdjacentImages(bool forward, int count) {
+    QStringList adjacentImages;
+    int rowCount = thumbsViewerModel->rowCount();
+    int row = currentRow;
+
+    for (int step = 1; step < rowCount && adjacentImages.size() < count; ++step) {
+        row += forward ? 1 : -1;
+        if (row < 0 || row >= rowCount) {
+            if (!Settings::wrapImageList) {
+                break;
+            }
+            row = (row + rowCount) % rowCount;
+        }
+
+        if (row == currentRow) {
+            break;
+        }
+
+        if (!isRowHidden(row)) {
+            adjacentImages << thumbsViewerModel->item(row)->data(FileNameRole).toString();
+        }
+    }
+
+    return adjacentImages;
+}
+
+QStringList ThumbsViewer::getSlideShowOrder(bool random, bool wrap, int startRow, uint seed) {
+    QStringList order;
+    int rowCount = thumbsViewerModel->rowCount();
+    if (startRow < 0 || startRow >= rowCount) {
+        startRow = 0;
+    }
+
+    /* Without wrapping a show ends at the last row, random shows always take every row */
+    int stepCount = (random || wrap) ? rowCount : rowCount - startRow;
+    for (int step = 0; step < stepCount; ++step) {
+        int row = (startRow + step) % rowCount;
+        if (!isRowHidden(row)) {
+            order << thumbsViewerModel->item(row)->data(FileNameRole).toString();
+        }
+    }
+
+    if (random) {
+        std::mt19937 generator(seed);
+        std::shuffle(order.begin(), order.end(), generator);
+    }
+
+    return order;
+}
+
+int ThumbsViewer::getVisibleThumbsCount() {
+    return thumbsViewerModel->rowCount() - hiddenThumbsCount;
+}
+
+void ThumbsViewer::setThumbHidden(int row, bool hidden) {
+    if (isRowHidden(row) == hidden) {
+        return;
+    }
+
+    if (hidden) {
+        selectionModel()->select(thumbsViewerModel->index(row, 0), QItemSelectionModel::Deselect);
+        ++hiddenThumbsCount;
+    } else {
+        --hiddenThumbsCount;
+    }
+
+    setRowHidden(row, hidden);
+}
+
+/* Called after rows were hidden or shown, the loaded thumbnails are kept */
+void ThumbsViewer::thumbsFilterChanged() {
+    if (isRowHidden(currentRow)) {
+        int row = getNextRow();
+        if (row < 0) {
+            row = getFirstRow();
+        }
+
+        /* Nothing left to show, the current row stays until the filter changes again */
+        if (row >= 0) {
+            setCurrentRow(row);
+        }
+    }
+
+    thumbsRangeFirst = -1;
+    thumbsRangeLast = -1;
+    loadVisibleThumbs(verticalScrollBar()->value());
+    updateThumbsCount();
+}
+
+/* Reloads the thumbnails of the given images, e.g. after their files were modified */
+void ThumbsViewer::invalidateThumbs(const QStringList &imageFileNames) {
+    QSet<QString> invalidFileNames = imageFileNames.toSet();
+    if (invalidFileNames.isEmpty()) {
+        return;
+    }
+
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        QStandardItem *thumbItem = thumbsViewerModel->item(row);
+        if (invalidFileNames.contains(thumbItem->data(FileNameRole).toString())) {
+            metadataCache->loadImageMetadata(thumbItem->data(FileNameRole).toString());
+            thumbItem->setData(false, LoadedRole);
+        }
+    }
+
+    thumbsRangeFirst = -1;
+    thumbsRangeLast = -1;
+    loadVisibleThumbs(verticalScrollBar()->value());
 }
 
 int ThumbsViewer::getCurrentRow() {
@@ -131,11 +309,27 @@ void ThumbsViewer::setCurrentRow(int row) {
 }
 
 void ThumbsViewer::setImageViewerWindowTitle() {
-    QString title = thumbsViewerModel->item(currentRow)->data(Qt::DisplayRole).toString()
+    QStandardItem *currentItem = thumbsViewerModel->item(currentRow);
+    if (!currentItem) {
+        return;
+    }
+
+    /* The position among the images the tags filter leaves visible */
+    int visiblePosition = currentRow + 1;
+    if (hiddenThumbsCount) {
+        visiblePosition = 0;
+        for (int row = 0; row <= currentRow; ++row) {
+            if (!isRowHidden(row)) {
+                ++visiblePosition;
+            }
+        }
+    }
+
+    QString title = currentItem->data(Qt::DisplayRole).toString()
                     + " - ["
-                    + QString::number(currentRow + 1)
+                    + QString::number(visiblePosition)
                     + "/"
-                    + QString::number(thumbsViewerModel->rowCount())
+                    + QString::number(getVisibleThumbsCount())
                     + "] - Phototonic";
 
     phototonic->setWindowTitle(title);
@@ -152,6 +346,12 @@ bool ThumbsViewer::setCurrentIndexByName(QString &fileName) {
     return false;
 }
 
+int ThumbsViewer::getRowByName(const QString &fileName) {
+    QModelIndexList indexList = thumbsViewerModel->match(thumbsViewerModel->index(0, 0), FileNameRole, fileName, 1,
+                                                         Qt::MatchExactly);
+    return indexList.size() ? indexList[0].row() : -1;
+}
+
 bool ThumbsViewer::setCurrentIndexByRow(int row) {
     QModelIndex idx = thumbsViewerModel->indexFromItem(thumbsViewerModel->item(row));
     if (idx.isValid()) {
@@ -267,10 +467,11 @@ void ThumbsViewer::onSelectionChanged(const QItemSelection &) {
         QString thumbFullPath = thumbsViewerModel->item(currentRow)->data(FileNameRole).toString();
         setCurrentRow(currentRow);
         updateImageInfoViewer(thumbFullPath);
-        QPixmap imagePreviewPixmap = imagePreview->loadImage(thumbFullPath);
+        QImage imagePreviewImage = imagePreview->loadImage(thumbFullPath);
         if (Settings::setWindowIcon && Settings::layoutMode == Phototonic::ThumbViewWidget) {
-            phototonic->setWindowIcon(imagePreviewPixmap.scaled(WINDOW_ICON_SIZE, WINDOW_ICON_SIZE,
-                                                                Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            phototonic->setWindowIcon(QPixmap::fromImage(imagePreviewImage.scaled(WINDOW_ICON_SIZE, WINDOW_ICON_SIZE,
+                                                                                  Qt::KeepAspectRatio,
+                                                                                  Qt::SmoothTransformation)));
         }
     }
 
@@ -281,7 +482,7 @@ void ThumbsViewer::onSelectionChanged(const QItemSelection &) {
     if (selectedThumbs >= 1) {
         QString statusStr;
         statusStr = tr("Selected %1 of %2").arg(QString::number(selectedThumbs))
-                .arg(tr(" %n image(s)", "", thumbsViewerModel->rowCount()));
+                .arg(tr(" %n image(s)", "", getVisibleThumbsCount()));
         phototonic->setStatus(statusStr);
     } else if (!selectedThumbs) {
         updateThumbsCount();
@@ -293,6 +494,9 @@ QStringList ThumbsViewer::getSelectedThumbsList() {
     QStringList SelectedThumbsPaths;
 
     for (int tn = indexesList.size() - 1; tn >= 0; --tn) {
+        if (isRowHidden(indexesList[tn].row())) {
+            continue;
+        }
         SelectedThumbsPaths << thumbsViewerModel->item(indexesList[tn].row())->data(FileNameRole).toString();
     }
 
@@ -399,6 +603,10 @@ int ThumbsViewer::getFirstVisibleThumb() {
     QModelIndex idx;
 
     for (int currThumb = 0; currThumb < thumbsViewerModel->rowCount(); ++currThumb) {
+        if (isRowHidden(currThumb)) {
+            continue;
+        }
+
         idx = thumbsViewerModel->indexFromItem(thumbsViewerModel->item(currThumb));
         if (viewport()->rect().contains(QPoint(0, visualRect(idx).y() + visualRect(idx).height() + 1))) {
             return idx.row();
@@ -412,6 +620,10 @@ int ThumbsViewer::getLastVisibleThumb() {
     QModelIndex idx;
 
     for (int currThumb = thumbsViewerModel->rowCount() - 1; currThumb >= 0; --currThumb) {
+        if (isRowHidden(currThumb)) {
+            continue;
+        }
+
         idx = thumbsViewerModel->indexFromItem(thumbsViewerModel->item(currThumb));
         if (viewport()->rect().contains(QPoint(0, visualRect(idx).y() + visualRect(idx).height() + 1))) {
             return idx.row();
@@ -429,8 +641,8 @@ void ThumbsViewer::loadFileList() {
 
     imageTags->populateTagsTree();
 
-    if (thumbFileInfoList.size() && selectionModel()->selectedIndexes().size() == 0) {
-        selectThumbByRow(0);
+    if (getFirstRow() >= 0 && selectionModel()->selectedIndexes().size() == 0) {
+        selectThumbByRow(getFirstRow());
     }
 
     phototonic->showBusyAnimation(false);
@@ -528,6 +740,7 @@ void ThumbsViewer::applyFilter() {
 void ThumbsViewer::loadPrepare() {
 
     thumbsViewerModel->clear();
+    hiddenThumbsCount = 0;
     setIconSize(QSize(thumbSize, thumbSize));
     setSpacing(QFontMetrics(font()).height());
 
@@ -558,9 +771,6 @@ void ThumbsViewer::initThumbs() {
         thumbFileInfo = thumbFileInfoList.at(fileIndex);
 
         metadataCache->loadImageMetadata(thumbFileInfo.filePath());
-        if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(thumbFileInfo.filePath())) {
-            continue;
-        }
 
         thumbItem = new QStandardItem();
         thumbItem->setData(false, LoadedRole);
@@ -571,6 +781,9 @@ void ThumbsViewer::initThumbs() {
         thumbItem->setText(thumbFileInfo.fileName());
 
         thumbsViewerModel->appendRow(thumbItem);
+        if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(thumbFileInfo.filePath())) {
+            setThumbHidden(thumbItem->row(), true);
+        }
 
         ++thumbsAddedCounter;
         if (thumbsAddedCounter > 100) {
@@ -581,16 +794,16 @@ void ThumbsViewer::initThumbs() {
 
     imageTags->populateTagsTree();
 
-    if (thumbFileInfoList.size() && selectionModel()->selectedIndexes().size() == 0) {
-        selectThumbByRow(0);
+    if (getFirstRow() >= 0 && selectionModel()->selectedIndexes().size() == 0) {
+        selectThumbByRow(getFirstRow());
     }
 }
 
 void ThumbsViewer::updateThumbsCount() {
     QString state;
 
-    if (thumbsViewerModel->rowCount() > 0) {
-        state = tr("%n image(s)", "", thumbsViewerModel->rowCount());
+    if (getVisibleThumbsCount() > 0) {
+        state = tr("%n image(s)", "", getVisibleThumbsCount());
     } else {
         state = tr("No images");
     }
@@ -605,7 +818,6 @@ void ThumbsViewer::selectThumbByRow(int row) {
 
 void ThumbsViewer::loadThumbsRange() {
     static bool isInProgress = false;
-    QImageReader thumbReader;
     static QSize currentThumbSize;
     static int currentRowCount;
     static QString imageFileName;
@@ -630,31 +842,14 @@ void ThumbsViewer::loadThumbsRange() {
             break;
         }
 
-        if (thumbsViewerModel->item(currThumb)->data(LoadedRole).toBool()) {
+        if (isRowHidden(currThumb) || thumbsViewerModel->item(currThumb)->data(LoadedRole).toBool()) {
             continue;
         }
 
         imageFileName = thumbsViewerModel->item(currThumb)->data(FileNameRole).toString();
-        thumbReader.setFileName(imageFileName);
-        currentThumbSize = thumbReader.size();
-        imageReadOk = false;
-
-        if (currentThumbSize.isValid()) {
-            if (currentThumbSize.width() > thumbSize || currentThumbSize.height() > thumbSize) {
-                currentThumbSize.scale(QSize(thumbSize, thumbSize), Qt::KeepAspectRatio);
-            }
-
-            thumbReader.setScaledSize(currentThumbSize);
-            imageReadOk = thumbReader.read(&thumb);
-        }
+        imageReadOk = readThumb(imageFileName, thumb);
 
         if (imageReadOk) {
-            if (Settings::exifThumbRotationEnabled) {
-                imageViewer->rotateByExifRotation(thumb, imageFileName);
-                currentThumbSize = thumb.size();
-                currentThumbSize.scale(QSize(thumbSize, thumbSize), Qt::KeepAspectRatio);
-            }
-
             thumbsViewerModel->item(currThumb)->setIcon(QPixmap::fromImage(thumb));
         } else {
             thumbsViewerModel->item(currThumb)->setIcon(QIcon::fromTheme("image-missing",
@@ -672,15 +867,30 @@ void ThumbsViewer::loadThumbsRange() {
     isAbortThumbsLoading = false;
 }
 
+/* Cache misses are decoded here and stored on a worker, the GUI thread never encodes or writes thumbnails */
+bool ThumbsViewer::readThumb(const QString &imageFileName, QImage &thumb) {
+    QString orientationFileName = imageFileName;
+    long orientation = Settings::exifThumbRotationEnabled ? metadataCache->getImageOrientation(orientationFileName) : 0;
+
+    /* The shared cache holds upright thumbnails, with Exif rotation off it is neither read nor written */
+    bool cacheEnabled = Settings::exifThumbRotationEnabled;
+    bool cached;
+    if (!ThumbnailCache::read(imageFileName, thumbSize, orientation, thumb, cached, cacheEnabled)) {
+        return false;
+    }
+
+    int cacheSize = ThumbnailCache::getCacheSize(thumbSize);
+    if (cacheEnabled && !cached && cacheSize) {
+        thumbnailCacheThreadPool()->start(new ThumbnailCacheTask(imageFileName, cacheSize));
+    }
+    return true;
+}
+
 void ThumbsViewer::addThumb(QString &imageFullPath) {
 
     metadataCache->loadImageMetadata(imageFullPath);
-    if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(imageFullPath)) {
-        return;
-    }
 
     QStandardItem *thumbItem = new QStandardItem();
-    QImageReader thumbReader;
     QSize hintSize;
     QSize currThumbSize;
     static QImage thumb;
@@ -695,22 +905,7 @@ void ThumbsViewer::addThumb(QString &imageFullPath) {
     thumbItem->setData(thumbFileInfo.fileName(), Qt::DisplayRole);
     thumbItem->setSizeHint(hintSize);
 
-    thumbReader.setFileName(imageFullPath);
-    currThumbSize = thumbReader.size();
-    if (currThumbSize.isValid()) {
-        if (currThumbSize.width() > thumbSize || currThumbSize.height() > thumbSize) {
-            currThumbSize.scale(QSize(thumbSize, thumbSize), Qt::KeepAspectRatio);
-        }
-
-        thumbReader.setScaledSize(currThumbSize);
-        thumb = thumbReader.read();
-
-        if (Settings::exifThumbRotationEnabled) {
-            imageViewer->rotateByExifRotation(thumb, imageFullPath);
-            currThumbSize = thumb.size();
-            currThumbSize.scale(QSize(thumbSize, thumbSize), Qt::KeepAspectRatio);
-        }
-
+    if (readThumb(imageFullPath, thumb)) {
         thumbItem->setIcon(QPixmap::fromImage(thumb));
     } else {
         thumbItem->setIcon(
@@ -721,6 +916,9 @@ void ThumbsViewer::addThumb(QString &imageFullPath) {
     }
 
     thumbsViewerModel->appendRow(thumbItem);
+    if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(imageFullPath)) {
+        setThumbHidden(thumbItem->row(), true);
+    }
 }
 
 void ThumbsViewer::wheelEvent(QWheelEvent *event) {
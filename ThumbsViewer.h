@@ -64,6 +64,9 @@ public:
 
     bool setCurrentIndexByName(QString &fileName);
 
+    /* -1 when the image is not in the list */
+    int getRowByName(const QString &fileName);
+
     bool setCurrentIndexByRow(int row);
 
     void setCurrentRow(int row);
@@ -84,12 +87,29 @@ public:
 
     int getPrevRow();
 
+    int getFirstRow();
+
     int getLastRow();
 
     int getRandomRow();
 
+    QStringList getAdjacentImages(bool forward, int count);
+
+    /* The file names of the visible rows in slide show order, in random mode shuffled the same way for the same seed */
+    QStringList getSlideShowOrder(bool random, bool wrap, int startRow, uint seed);
+
     int getCurrentRow();
 
+    int getVisibleThumbsCount();
+
+    void setThumbHidden(int row, bool hidden);
+
+    void thumbsFilterChanged();
+
+    void invalidateThumbs(const QStringList &imageFileNames);
+
+    void updateThumbsCount();
+
     QStringList getSelectedThumbsList();
 
     QString getSingleSelectionFilename();
@@ -121,10 +141,10 @@ private:
 
     int getLastVisibleThumb();
 
-    void updateThumbsCount();
-
     void updateImageInfoViewer(QString imageFullPath);
 
+    bool readThumb(const QString &imageFileName, QImage &thumb);
+
     QFileInfo thumbFileInfo;
     QFileInfoList thumbFileInfoList;
     QImage emptyImg;
@@ -135,6 +155,7 @@ private:
     bool isAbortThumbsLoading;
     bool isNeedToScroll;
     int currentRow;
+    int hiddenThumbsCount;
     bool scrolledForward;
     int thumbsRangeFirst;
     int thumbsRangeLast;
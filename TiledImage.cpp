@@ -0,0 +1,291 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QRunnable>
+#include <QImageIOHandler>
+#include "TiledImage.h"
+#include "OrientationKernel.h"
+#include "ColorizeKernel.h"
+#include "ColorLut.h"
+
+class TileRowDecodeTask : public QRunnable {
+
+public:
+    TileRowDecodeTask(TiledImage *tiledImage, int level, int tileY) {
+        this->tiledImage = tiledImage;
+        this->level = level;
+        this->tileY = tileY;
+    }
+
+    void run() {
+        tiledImage->decodeTileRow(level, tileY);
+    }
+
+private:
+    TiledImage *tiledImage;
+    int level;
+    int tileY;
+};
+
+TiledImage::TiledImage(QObject *parent, const QString &imageFileName, const QSize &imageSize,
+                       const QImage &sourceBaseImage, const QImage &baseImage,
+                       const ImageProcessor::Parameters &parameters) : QObject(parent) {
+    this->imageFileName = imageFileName;
+    this->imageSize = imageSize;
+    this->sourceBaseImage = sourceBaseImage;
+    this->baseImage = baseImage;
+    this->parameters = parameters;
+    colorsGeneration = 0;
+
+    /* Levels at or below the resolution of the base image are never decoded as tiles */
+    levelCount = 0;
+    while (!baseImage.isNull() && (getLevelSize(levelCount).width() > baseImage.width()
+           || getLevelSize(levelCount).height() > baseImage.height())) {
+        ++levelCount;
+    }
+
+    /* Costs are in KB */
+    tiles.setMaxCost(TILE_CACHE_BUDGET_MB * 1024);
+    threadPool.setMaxThreadCount(TILE_DECODE_THREADS);
+}
+
+TiledImage::~TiledImage() {
+    {
+        QMutexLocker locker(&mutex);
+        wantedTiles.clear();
+    }
+    threadPool.clear();
+    threadPool.waitForDone();
+}
+
+bool TiledImage::isTileable(QImageReader &imageReader) {
+    QSize size = imageReader.size();
+    if (!size.isValid() || (qint64) size.width() * size.height() < TILED_IMAGE_MIN_PIXELS) {
+        return false;
+    }
+
+    return imageReader.supportsOption(QImageIOHandler::ClipRect)
+           && imageReader.supportsOption(QImageIOHandler::ScaledSize)
+           && !imageReader.supportsAnimation();
+}
+
+bool TiledImage::isTileable(const QSize &imageSize, const ImageProcessor::Parameters &parameters) {
+    if (parameters.scaledWidth || parameters.scaledHeight) {
+        return false;
+    }
+
+    QSize transformedSize;
+    QTransform matrix = ImageProcessor::getTransform(imageSize, parameters, transformedSize);
+    return !transformedSize.isEmpty() && OrientationKernel::getOrientation(matrix) != 0;
+}
+
+void TiledImage::setParameters(const ImageProcessor::Parameters &parameters) {
+    QMutexLocker locker(&mutex);
+    bool colorsChanged = parameters.applyColors != this->parameters.applyColors
+                         || (parameters.applyColors && !ColorLut::hasSameColors(parameters, this->parameters));
+    this->parameters = parameters;
+    if (!colorsChanged) {
+        return;
+    }
+
+    ++colorsGeneration;
+    baseImage = sourceBaseImage;
+    if (parameters.applyColors) {
+        ImageProcessor::colorize(baseImage, parameters);
+    }
+}
+
+quint64 TiledImage::tileKey(int level, int tileX, int tileY) {
+    return ((quint64) level << 48) | ((quint64) tileY << 24) | (quint64) tileX;
+}
+
+/* In KB */
+int TiledImage::tileCost(const Tile &tile) {
+    qint64 bytes = (qint64) tile.image.bytesPerLine() * tile.image.height()
+                   + (qint64) tile.coloredImage.bytesPerLine() * tile.coloredImage.height();
+    return qMax(1, (int) (bytes / 1024));
+}
+
+QSize TiledImage::getImageSize() const {
+    return imageSize;
+}
+
+QImage TiledImage::getBaseImage() const {
+    return baseImage;
+}
+
+int TiledImage::getLevelCount() const {
+    return levelCount;
+}
+
+int TiledImage::getLevel(qreal scale) const {
+    int level = 0;
+    while (level < levelCount && scale * (2 << level) <= 1.0) {
+        ++level;
+    }
+    return level;
+}
+
+QSize TiledImage::getLevelSize(int level) const {
+    int divisor = 1 << level;
+    return QSize((imageSize.width() + divisor - 1) / divisor, (imageSize.height() + divisor - 1) / divisor);
+}
+
+QRect TiledImage::getTileRange(int level, const QRect &levelRect) const {
+    QRect rect = levelRect & QRect(QPoint(0, 0), getLevelSize(level));
+    if (rect.isEmpty()) {
+        return QRect();
+    }
+
+    return QRect(QPoint(rect.left() / TILE_SIZE, rect.top() / TILE_SIZE),
+                 QPoint(rect.right() / TILE_SIZE, rect.bottom() / TILE_SIZE));
+}
+
+QRect TiledImage::getTileRect(int level, int tileX, int tileY) const {
+    return QRect(tileX * TILE_SIZE, tileY * TILE_SIZE, TILE_SIZE, TILE_SIZE)
+           & QRect(QPoint(0, 0), getLevelSize(level));
+}
+
+bool TiledImage::findTile(int level, int tileX, int tileY, QImage &tile) {
+    QMutexLocker locker(&mutex);
+    quint64 key = tileKey(level, tileX, tileY);
+    Tile *cachedTile = tiles.object(key);
+    if (!cachedTile) {
+        return false;
+    }
+
+    if (!parameters.applyColors) {
+        tile = cachedTile->image;
+        return true;
+    }
+
+    /* Decoded before the current color edits, colored again from its decoded pixels */
+    if (cachedTile->colorsGeneration != colorsGeneration || cachedTile->coloredImage.isNull()) {
+        Tile *coloredTile = new Tile;
+        coloredTile->image = cachedTile->image;
+        coloredTile->coloredImage = cachedTile->image;
+        ColorizeKernel(parameters).apply(coloredTile->coloredImage, 1);
+        coloredTile->colorsGeneration = colorsGeneration;
+        tile = coloredTile->coloredImage;
+        tiles.insert(key, coloredTile, tileCost(*coloredTile));
+        return true;
+    }
+
+    tile = cachedTile->coloredImage;
+    return true;
+}
+
+void TiledImage::requestTiles(int level, const QRect &tileRange) {
+    QMutexLocker locker(&mutex);
+    QSet<quint64> tileKeys;
+
+    for (int tileY = tileRange.top(); tileY <= tileRange.bottom(); ++tileY) {
+        bool rowNeeded = false;
+        for (int tileX = tileRange.left(); tileX <= tileRange.right(); ++tileX) {
+            quint64 key = tileKey(level, tileX, tileY);
+            tileKeys.insert(key);
+            if (!tiles.contains(key) && !decodingTiles.contains(key)) {
+                rowNeeded = true;
+            }
+        }
+
+        quint64 rowKey = tileKey(level, 0, tileY);
+        if (rowNeeded && !queuedRows.contains(rowKey)) {
+            queuedRows.insert(rowKey);
+            threadPool.start(new TileRowDecodeTask(this, level, tileY));
+        }
+    }
+
+    wantedTiles = tileKeys;
+}
+
+/* Runs on a worker thread, decodes the span of the row covering all of its wanted tiles */
+void TiledImage::decodeTileRow(int level, int tileY) {
+    int firstTileX = -1;
+    int lastTileX = -1;
+    ImageProcessor::Parameters tileParameters;
+    int tileColorsGeneration;
+
+    {
+        QMutexLocker locker(&mutex);
+        queuedRows.remove(tileKey(level, 0, tileY));
+        tileParameters = parameters;
+        tileColorsGeneration = colorsGeneration;
+
+        int tileColumns = (getLevelSize(level).width() + TILE_SIZE - 1) / TILE_SIZE;
+        for (int tileX = 0; tileX < tileColumns; ++tileX) {
+            quint64 key = tileKey(level, tileX, tileY);
+            if (wantedTiles.contains(key) && !decodingTiles.contains(key) && !tiles.contains(key)) {
+                if (firstTileX < 0) {
+                    firstTileX = tileX;
+                }
+                lastTileX = tileX;
+            }
+        }
+
+        if (firstTileX < 0) {
+            return;
+        }
+
+        for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            decodingTiles.insert(tileKey(level, tileX, tileY));
+        }
+    }
+
+    QRect stripRect = getTileRect(level, firstTileX, tileY) | getTileRect(level, lastTileX, tileY);
+    QRect sourceRect = QRect(stripRect.topLeft() * (1 << level), stripRect.size() * (1 << level))
+                       & QRect(QPoint(0, 0), imageSize);
+
+    QImage strip;
+    QImageReader imageReader(imageFileName);
+    imageReader.setClipRect(sourceRect);
+    if (level) {
+        imageReader.setScaledSize(stripRect.size());
+    }
+    bool decoded = imageReader.read(&strip);
+    QImage coloredStrip;
+    if (decoded && tileParameters.applyColors) {
+        coloredStrip = strip;
+        ColorizeKernel colorizeKernel(tileParameters);
+        colorizeKernel.apply(coloredStrip, 1);
+    }
+
+    QMutexLocker locker(&mutex);
+    for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+        quint64 key = tileKey(level, tileX, tileY);
+        decodingTiles.remove(key);
+        if (decoded) {
+            QRect tileRect = getTileRect(level, tileX, tileY).translated(-stripRect.topLeft());
+            Tile *tile = new Tile;
+            tile->image = strip.copy(tileRect);
+            if (!coloredStrip.isNull()) {
+                tile->coloredImage = coloredStrip.copy(tileRect);
+            }
+            tile->colorsGeneration = tileColorsGeneration;
+            tiles.insert(key, tile, tileCost(*tile));
+        }
+    }
+
+    if (decoded) {
+        QMetaObject::invokeMethod(this, "onTileDecoded", Qt::QueuedConnection);
+    }
+}
+
+void TiledImage::onTileDecoded() {
+    emit tilesDecoded();
+}
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QCache>
+#include <QSet>
+#include <QImage>
+#include <QImageReader>
+#include <QString>
+#include <QSize>
+#include <QRect>
+#include "ImageProcessor.h"
+
+#define TILE_SIZE 512
+#define TILE_CACHE_BUDGET_MB 96
+#define TILE_DECODE_THREADS 2
+#define TILED_IMAGE_MIN_PIXELS (64 * 1024 * 1024)
+#define TILED_BASE_LEVEL_SIZE 2048
+
+/*
+ * Image pyramid for pictures too large to decode in one piece.
+ * Level 0 is the full resolution and every further level halves it. Each level is split
+ * into tiles that are decoded on demand, straight from the file, on background threads.
+ * The wanted tiles of a tile row are decoded together as one strip, since a clipped decode
+ * still has to read the file up to the bottom of the clip rectangle.
+ * A downscaled base image covers the coarsest levels and stands in for tiles not decoded yet.
+ * Tiles are in the stored orientation, color edits are applied to each tile as it is decoded.
+ * Tiles keep their decoded pixels, so that new color edits are applied again without a decode.
+ * Memory use is limited by the tile cache budget, whatever the image size.
+ */
+class TiledImage : public QObject {
+Q_OBJECT
+
+public:
+    /* baseImage is sourceBaseImage with the color edits of parameters applied */
+    TiledImage(QObject *parent, const QString &imageFileName, const QSize &imageSize,
+               const QImage &sourceBaseImage, const QImage &baseImage, const ImageProcessor::Parameters &parameters);
+
+    ~TiledImage();
+
+    /* Only formats that can decode a region without decoding the whole image are worth tiling */
+    static bool isTileable(QImageReader &imageReader);
+
+    /* Orientation, quarter turns, flips and crops are drawn with the tiles, anything else needs the whole image */
+    static bool isTileable(const QSize &imageSize, const ImageProcessor::Parameters &parameters);
+
+    /* Colors the base image again when the color edits changed, cached tiles follow as they are drawn */
+    void setParameters(const ImageProcessor::Parameters &parameters);
+
+    QSize getImageSize() const;
+
+    QImage getBaseImage() const;
+
+    int getLevelCount() const;
+
+    /* Coarsest level whose resolution is still needed for the given display scale */
+    int getLevel(qreal scale) const;
+
+    QSize getLevelSize(int level) const;
+
+    /* Tiles of the level intersecting levelRect, in level coordinates */
+    QRect getTileRange(int level, const QRect &levelRect) const;
+
+    QRect getTileRect(int level, int tileX, int tileY) const;
+
+    bool findTile(int level, int tileX, int tileY, QImage &tile);
+
+    /* Replaces the set of wanted tiles, queued decodes of tiles no longer wanted are dropped */
+    void requestTiles(int level, const QRect &tileRange);
+
+    void decodeTileRow(int level, int tileY);
+
+signals:
+
+    void tilesDecoded();
+
+private slots:
+
+    void onTileDecoded();
+
+private:
+    /* Decoded pixels, and the same with the color edits of colorsGeneration when they are on */
+    struct Tile {
+        QImage image;
+        QImage coloredImage;
+        int colorsGeneration;
+    };
+
+    QString imageFileName;
+    QSize imageSize;
+    QImage sourceBaseImage;
+    QImage baseImage;
+    ImageProcessor::Parameters parameters;
+    int colorsGeneration;
+    int levelCount;
+    QThreadPool threadPool;
+    QMutex mutex;
+    QCache<quint64, Tile> tiles;
+    QSet<quint64> wantedTiles;
+    QSet<quint64> decodingTiles;
+    QSet<quint64> queuedRows;
+
+    static quint64 tileKey(int level, int tileX, int tileY);
+
+    static int tileCost(const Tile &tile);
+};
+
+#endif // TILED_IMAGE_H
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TiledImageView.h"
+#include "ImageProcessor.h"
+
+TiledImageView::TiledImageView(QWidget *parent) : QWidget(parent) {
+    tiledImage = nullptr;
+    mirrorLayout = 0;
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void TiledImageView::setImage(const QString &imageFileName, const QSize &imageSize, const QImage &sourceBaseImage,
+                              const QImage &baseImage, const ImageProcessor::Parameters &parameters) {
+    clear();
+    imageTransform = ImageProcessor::getTransform(imageSize, parameters, transformedSize);
+    tiledImage = new TiledImage(this, imageFileName, imageSize, sourceBaseImage, baseImage, parameters);
+    connect(tiledImage, SIGNAL(tilesDecoded()), this, SLOT(update()));
+    update();
+}
+
+void TiledImageView::setParameters(const ImageProcessor::Parameters &parameters) {
+    if (!tiledImage) {
+        return;
+    }
+
+    imageTransform = ImageProcessor::getTransform(tiledImage->getImageSize(), parameters, transformedSize);
+    tiledImage->setParameters(parameters);
+    update();
+}
+
+void TiledImageView::clear() {
+    delete tiledImage;
+    tiledImage = nullptr;
+}
+
+bool TiledImageView::hasImage() const {
+    return tiledImage != nullptr;
+}
+
+QSize TiledImageView::getImageSize() const {
+    return tiledImage ? transformedSize : QSize();
+}
+
+void TiledImageView::setMirrorLayout(int mirrorLayout) {
+    this->mirrorLayout = mirrorLayout;
+    update();
+}
+
+QRect TiledImageView::mapToLevel(const QRectF &imageRect, int level) const {
+    qreal divisor = 1 << level;
+    return QRectF(imageRect.x() / divisor, imageRect.y() / divisor,
+                  imageRect.width() / divisor, imageRect.height() / divisor).toAlignedRect();
+}
+
+void TiledImageView::paintEvent(QPaintEvent *event) {
+    QSize grid = ImageProcessor::getMirrorGrid(mirrorLayout);
+    QSize cellSize(width() / grid.width(), height() / grid.height());
+    if (!tiledImage || cellSize.isEmpty() || transformedSize.isEmpty()) {
+        return;
+    }
+
+    /* Orientation and crop first, then the zoom */
+    qreal scaleX = (qreal) cellSize.width() / transformedSize.width();
+    qreal scaleY = (qreal) cellSize.height() / transformedSize.height();
+    QTransform imageToCell = imageTransform * QTransform::fromScale(scaleX, scaleY);
+    int level = tiledImage->getLevel(qMax(scaleX, scaleY));
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    QRectF imageRect(QPointF(0, 0), tiledImage->getImageSize());
+    QRect visibleRect = visibleRegion().boundingRect();
+    QRectF wantedRect;
+    for (int row = 0; row < grid.height(); ++row) {
+        for (int column = 0; column < grid.width(); ++column) {
+            QTransform cellTransform = ImageProcessor::getMirrorCellTransform(column, row, cellSize);
+            QRect cellRect = cellTransform.mapRect(QRect(QPoint(0, 0), cellSize));
+            QTransform transform = imageToCell * cellTransform;
+            QTransform inverseTransform = transform.inverted();
+            wantedRect |= inverseTransform.mapRect(QRectF(visibleRect & cellRect)) & imageRect;
+
+            QRect exposedRect = event->rect() & cellRect;
+            if (!exposedRect.isEmpty()) {
+                /* A crop maps part of the image outside of the cell */
+                painter.resetTransform();
+                painter.setClipRect(exposedRect);
+                painter.setTransform(transform);
+                paintCell(painter, inverseTransform.mapRect(QRectF(exposedRect)) & imageRect, level);
+            }
+        }
+    }
+
+    /* Ask for everything visible, a partial repaint while panning must not drop the other tiles */
+    if (level < tiledImage->getLevelCount() && !wantedRect.isEmpty()) {
+        tiledImage->requestTiles(level, tiledImage->getTileRange(level, mapToLevel(wantedRect, level)));
+    }
+}
+
+void TiledImageView::paintCell(QPainter &painter, const QRectF &exposedRect, int level) {
+    if (exposedRect.isEmpty()) {
+        return;
+    }
+
+    /* The base image goes first, tiles that are not decoded yet show it through */
+    QImage baseImage = tiledImage->getBaseImage();
+    QSize imageSize = tiledImage->getImageSize();
+    qreal baseScaleX = (qreal) baseImage.width() / imageSize.width();
+    qreal baseScaleY = (qreal) baseImage.height() / imageSize.height();
+    painter.drawImage(exposedRect, baseImage,
+                      QRectF(exposedRect.x() * baseScaleX, exposedRect.y() * baseScaleY,
+                             exposedRect.width() * baseScaleX, exposedRect.height() * baseScaleY));
+
+    if (level >= tiledImage->getLevelCount()) {
+        return;
+    }
+
+    QTransform transform = painter.transform();
+    QTransform inverseTransform = transform.inverted();
+    QRectF imageRect(QPointF(0, 0), imageSize);
+    QRect tileRange = tiledImage->getTileRange(level, mapToLevel(exposedRect, level));
+    for (int tileY = tileRange.top(); tileY <= tileRange.bottom(); ++tileY) {
+        for (int tileX = tileRange.left(); tileX <= tileRange.right(); ++tileX) {
+            QImage tile;
+            if (!tiledImage->findTile(level, tileX, tileY, tile)) {
+                continue;
+            }
+
+            /* Round the edges in widget pixels so neighboring tiles meet without seams */
+            QRect tileRect = tiledImage->getTileRect(level, tileX, tileY);
+            QRectF sourceRect = QRectF(tileRect.topLeft() * (1 << level), tileRect.size() * (1 << level)) & imageRect;
+            QRectF targetRect = transform.mapRect(sourceRect);
+            targetRect = QRectF(QPointF(qRound(targetRect.left()), qRound(targetRect.top())),
+                                QPointF(qRound(targetRect.right()), qRound(targetRect.bottom())));
+            painter.drawImage(inverseTransform.mapRect(targetRect), tile);
+        }
+    }
+}
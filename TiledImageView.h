@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILED_IMAGE_VIEW_H
+#define TILED_IMAGE_VIEW_H
+
+#include <QWidget>
+#include <QPaintEvent>
+#include <QPainter>
+#include "TiledImage.h"
+#include "ImageProcessor.h"
+
+/*
+ * Stands in for the image view when a tiled image is shown. The widget is sized to the
+ * zoomed image like the image view, but only paints the tiles of the pyramid level matching
+ * the zoom that intersect the exposed area. Tiles stay in the stored orientation, the
+ * orientation and crop of the edits are applied by the painter transform.
+ */
+class TiledImageView : public QWidget {
+Q_OBJECT
+
+public:
+    TiledImageView(QWidget *parent);
+
+    void setImage(const QString &imageFileName, const QSize &imageSize, const QImage &sourceBaseImage,
+                  const QImage &baseImage, const ImageProcessor::Parameters &parameters);
+
+    /* New edits of the shown image, which must still be tileable with them */
+    void setParameters(const ImageProcessor::Parameters &parameters);
+
+    void clear();
+
+    bool hasImage() const;
+
+    QSize getImageSize() const;
+
+    void setMirrorLayout(int mirrorLayout);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+
+private:
+    TiledImage *tiledImage;
+    int mirrorLayout;
+
+    /* From stored image pixels to the edited image, and the size of the latter */
+    QTransform imageTransform;
+    QSize transformedSize;
+
+    QRect mapToLevel(const QRectF &imageRect, int level) const;
+
+    /* exposedRect is in stored image pixels, the painter maps them to the cell */
+    void paintCell(QPainter &painter, const QRectF &exposedRect, int level);
+};
+
+#endif // TILED_IMAGE_VIEW_H
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QXmlStreamReader>
+#include <exiv2/exiv2.hpp>
+#include "XmpSidecar.h"
+
+static const char dcNamespace[] = "http://purl.org/dc/elements/1.1/";
+static const char rdfNamespace[] = "http://www.w3.org/1999/02/22-rdf-syntax-ns#";
+
+QString XmpSidecar::fileName(const QString &imageFileName) {
+    return imageFileName + ".xmp";
+}
+
+bool XmpSidecar::readTags(const QString &imageFileName, QSet<QString> &tags) {
+    QFile sidecarFile(fileName(imageFileName));
+    if (!sidecarFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    /* A plain XML scan is enough for dc:subject and much cheaper than opening the sidecar with Exiv2 */
+    QXmlStreamReader xmlReader(&sidecarFile);
+    bool subjectFound = false;
+    bool inSubject = false;
+    while (!xmlReader.atEnd()) {
+        xmlReader.readNext();
+
+        if (xmlReader.isStartElement()) {
+            if (xmlReader.namespaceUri() == dcNamespace && xmlReader.name() == "subject") {
+                inSubject = true;
+                subjectFound = true;
+            } else if (inSubject && xmlReader.namespaceUri() == rdfNamespace && xmlReader.name() == "li") {
+                QString tag = xmlReader.readElementText().trimmed();
+                if (!tag.isEmpty()) {
+                    tags.insert(tag);
+                }
+            }
+        } else if (xmlReader.isEndElement()) {
+            if (xmlReader.namespaceUri() == dcNamespace && xmlReader.name() == "subject") {
+                inSubject = false;
+            }
+        }
+    }
+
+    /* Sidecars of other tools without keywords leave the embedded ones in place */
+    return subjectFound && !xmlReader.hasError();
+}
+
+bool XmpSidecar::writeTags(const QString &imageFileName, const QSet<QString> &tags) {
+    QString sidecarFileName = fileName(imageFileName);
+    Exiv2::Image::AutoPtr sidecarImage;
+
+    try {
+        if (QFile::exists(sidecarFileName)) {
+            sidecarImage = Exiv2::ImageFactory::open(sidecarFileName.toStdString());
+            sidecarImage->readMetadata();
+        } else {
+            sidecarImage = Exiv2::ImageFactory::create(Exiv2::ImageType::xmp, sidecarFileName.toStdString());
+        }
+
+        Exiv2::XmpData &xmpData = sidecarImage->xmpData();
+        Exiv2::XmpKey subjectKey("Xmp.dc.subject");
+
+        /* keep everything else other tools stored in the sidecar */
+        Exiv2::XmpData::iterator subjectIt = xmpData.findKey(subjectKey);
+        while (subjectIt != xmpData.end()) {
+            xmpData.erase(subjectIt);
+            subjectIt = xmpData.findKey(subjectKey);
+        }
+
+        /* An empty bag is written too, so a sidecar with all tags removed still overrides embedded keywords */
+        Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::xmpBag);
+        QSetIterator<QString> tagsIt(tags);
+        while (tagsIt.hasNext()) {
+            value->read(tagsIt.next().toStdString());
+        }
+        xmpData.add(subjectKey, value.get());
+
+        sidecarImage->writeMetadata();
+    }
+    catch (Exiv2::Error &error) {
+        return false;
+    }
+
+    return true;
+}
+
+bool XmpSidecar::copy(const QString &imageFileName, const QString &newImageFileName) {
+    if (!QFile::exists(fileName(imageFileName))) {
+        return true;
+    }
+
+    /* A left over sidecar at the destination would describe another image */
+    QFile::remove(fileName(newImageFileName));
+    return QFile::copy(fileName(imageFileName), fileName(newImageFileName));
+}
+
+bool XmpSidecar::rename(const QString &imageFileName, const QString &newImageFileName) {
+    if (!QFile::exists(fileName(imageFileName))) {
+        return true;
+    }
+
+    QFile::remove(fileName(newImageFileName));
+    return QFile::rename(fileName(imageFileName), fileName(newImageFileName));
+}
+
+bool XmpSidecar::remove(const QString &imageFileName) {
+    if (!QFile::exists(fileName(imageFileName))) {
+        return true;
+    }
+
+    return QFile::remove(fileName(imageFileName));
+}
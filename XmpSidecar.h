@@ -0,0 +1,47 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMP_SIDECAR_H
+#define XMP_SIDECAR_H
+
+#include <QString>
+#include <QSet>
+
+/*
+ * Keeps image tags in an XMP sidecar (image.jpg.xmp) as dc:subject keywords,
+ * so tagging never has to rewrite the image itself.
+ */
+class XmpSidecar {
+
+public:
+    static QString fileName(const QString &imageFileName);
+
+    /* Returns false when there is no readable sidecar for the image or it has no dc:subject */
+    static bool readTags(const QString &imageFileName, QSet<QString> &tags);
+
+    static bool writeTags(const QString &imageFileName, const QSet<QString> &tags);
+
+    /* The sidecar follows its image when it is copied, moved or deleted, true when there is none */
+    static bool copy(const QString &imageFileName, const QString &newImageFileName);
+
+    static bool rename(const QString &imageFileName, const QString &newImageFileName);
+
+    static bool remove(const QString &imageFileName);
+};
+
+#endif // XMP_SIDECAR_H
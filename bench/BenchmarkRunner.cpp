@@ -0,0 +1,254 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QVector>
+#include "BenchmarkRunner.h"
+#include "SyntheticCorpus.h"
+#include "MetadataCache.h"
+#include "MetadataIndex.h"
+#include "ThumbnailCache.h"
+#include "ColorizeKernel.h"
+#include "ColorLut.h"
+
+BenchmarkRunner::BenchmarkRunner(const QStringList &fileList, const QString &cacheDirectory, int iterations) {
+    this->fileList = fileList;
+    this->cacheDirectory = cacheDirectory;
+    this->iterations = qMax(1, iterations);
+}
+
+void BenchmarkRunner::measure(const QString &name, int itemsCount, std::function<void()> body,
+                              std::function<void()> prepare, const QJsonObject &details) {
+    QVector<qint64> times;
+
+    for (int i = 0; i < iterations; ++i) {
+        if (prepare) {
+            prepare();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        body();
+        times.append(timer.nsecsElapsed());
+    }
+
+    qint64 firstTime = times.first();
+    std::sort(times.begin(), times.end());
+    qint64 medianTime = times.at(times.size() / 2);
+
+    QJsonObject result = details;
+    result["name"] = name;
+    result["iterations"] = iterations;
+    result["items"] = itemsCount;
+    result["firstMs"] = firstTime / 1e6;
+    result["bestMs"] = times.first() / 1e6;
+    result["medianMs"] = medianTime / 1e6;
+    if (itemsCount > 0) {
+        result["medianUsPerItem"] = medianTime / 1e3 / itemsCount;
+    }
+    results.append(result);
+}
+
+/* The listing ThumbsViewer builds before loading thumbnails */
+void BenchmarkRunner::benchmarkEnumeration(const QString &directory) {
+    QStringList nameFilters;
+    nameFilters << "*.bmp" << "*.gif" << "*.jpeg" << "*.jpg" << "*.jpe" << "*.png" << "*.tif" << "*.tiff"
+                << "*.webp" << "*.xpm";
+    int filesCount = 0;
+
+    measure("enumerate.entryInfoList", fileList.size(), [&]() {
+        QDir thumbsDir(directory, QString(), QDir::Name | QDir::IgnoreCase, QDir::Files);
+        thumbsDir.setNameFilters(nameFilters);
+        filesCount = thumbsDir.entryInfoList().size();
+    });
+
+    if (filesCount != fileList.size()) {
+        qWarning() << "Enumerated" << filesCount << "of" << fileList.size() << "files";
+    }
+}
+
+void BenchmarkRunner::benchmarkMetadata() {
+    MetadataCache metadataCache;
+    measure("metadata.loadImageMetadata", fileList.size(), [&]() {
+        for (const QString &fileName : fileList) {
+            metadataCache.loadImageMetadata(fileName);
+        }
+    }, [&]() {
+        metadataCache.clear();
+    });
+
+    /* The same lookups once the command line index mode has run */
+    MetadataIndex metadataIndex;
+    for (const QString &fileName : fileList) {
+        QSet<QString> tags;
+        long orientation = 0;
+        /* As the index command does, images without metadata get an empty entry */
+        if (!MetadataCache::readImageMetadata(fileName, orientation, tags)) {
+            orientation = 0;
+            tags.clear();
+        }
+        metadataIndex.insert(fileName, orientation, tags);
+    }
+    if (!metadataIndex.save()) {
+        qWarning() << "Failed to save" << MetadataIndex::getIndexPath();
+        return;
+    }
+
+    MetadataCache indexedMetadataCache;
+    measure("metadata.loadImageMetadata.indexed", fileList.size(), [&]() {
+        for (const QString &fileName : fileList) {
+            indexedMetadataCache.loadImageMetadata(fileName);
+        }
+    }, [&]() {
+        indexedMetadataCache.clear();
+    });
+}
+
+/* The per image work of ThumbsViewer::loadThumbsRange(), without the model and the widgets */
+void BenchmarkRunner::benchmarkThumbnails() {
+    int thumbSize = THUMBNAIL_CACHE_NORMAL_SIZE;
+    int failedCount = 0;
+
+    /* The viewer takes orientations from its metadata cache, loaded before thumbnails are read */
+    QHash<QString, long> orientations;
+    for (const QString &fileName : fileList) {
+        orientations.insert(fileName, MetadataCache::readImageOrientation(fileName));
+    }
+
+    /* The viewer's path on a cache miss: decode at thumbnail size and turn upright, the cache is not written */
+    measure("thumbnails.decode", fileList.size(), [&]() {
+        failedCount = 0;
+        for (const QString &fileName : fileList) {
+            QImage thumb;
+            bool cached;
+            if (!ThumbnailCache::read(fileName, thumbSize, orientations.value(fileName), thumb, cached)) {
+                ++failedCount;
+            }
+        }
+    }, [&]() {
+        QDir(cacheDirectory + "/thumbnails").removeRecursively();
+    });
+
+    if (failedCount) {
+        qWarning() << failedCount << "images failed to decode";
+    }
+
+    measure("thumbnails.create", fileList.size(), [&]() {
+        for (const QString &fileName : fileList) {
+            QImage thumb;
+            QString errorString;
+            ThumbnailCache::create(fileName, thumbSize, thumb, errorString);
+        }
+    }, [&]() {
+        QDir(cacheDirectory + "/thumbnails").removeRecursively();
+    });
+
+    int missedCount = 0;
+    /* The viewer's path on a cache hit, the stored thumbnail is already upright */
+    measure("thumbnails.cached", fileList.size(), [&]() {
+        missedCount = 0;
+        for (const QString &fileName : fileList) {
+            QImage thumb;
+            bool cached = false;
+            if (!ThumbnailCache::read(fileName, thumbSize, orientations.value(fileName), thumb, cached) || !cached) {
+                ++missedCount;
+            }
+        }
+    });
+
+    if (missedCount) {
+        qWarning() << missedCount << "thumbnails were not found in the cache";
+    }
+}
+
+/* Returns false when the vector, threaded or table code does not match the scalar code */
+bool BenchmarkRunner::benchmarkColorize(int width, int height) {
+    QImage source = SyntheticCorpus::createImage(width, height, 1);
+
+    ImageProcessor::Parameters parameters = ImageProcessor::Parameters();
+    parameters.hueVal = 40;
+    parameters.saturationVal = 130;
+    parameters.lightnessVal = 95;
+    parameters.contrastVal = 70;
+    parameters.brightVal = 110;
+    parameters.redVal = 10;
+    parameters.hueRedChannel = parameters.hueGreenChannel = parameters.hueBlueChannel = true;
+
+    ColorizeKernel scalarKernel(parameters);
+    scalarKernel.setVectorEnabled(false);
+    ColorizeKernel colorizeKernel(parameters);
+
+    QJsonObject details;
+    details["width"] = width;
+    details["height"] = height;
+    details["vectorEnabled"] = colorizeKernel.isVectorEnabled();
+
+    QImage scalarResult, vectorResult, threadedResult;
+    measure("colorize.scalar", 1, [&]() {
+        scalarKernel.apply(scalarResult, 1);
+    }, [&]() {
+        scalarResult = source.copy();
+    }, details);
+
+    measure("colorize.vector", 1, [&]() {
+        colorizeKernel.apply(vectorResult, 1);
+    }, [&]() {
+        vectorResult = source.copy();
+    }, details);
+
+    details["threads"] = QThread::idealThreadCount();
+    measure("colorize.threaded", 1, [&]() {
+        colorizeKernel.apply(threadedResult, 0);
+    }, [&]() {
+        threadedResult = source.copy();
+    }, details);
+
+    /* The table ImageProcessor switches to for large images, built once per settings */
+    QSharedPointer<ColorLut> colorLut;
+    measure("colorize.lut.build", 1, [&]() {
+        colorLut = QSharedPointer<ColorLut>(new ColorLut(parameters));
+    }, std::function<void()>(), details);
+
+    QImage lutResult, threadedLutResult;
+    details["threads"] = 1;
+    measure("colorize.lut", 1, [&]() {
+        colorLut->apply(lutResult, 1);
+    }, [&]() {
+        lutResult = source.copy();
+    }, details);
+
+    details["threads"] = QThread::idealThreadCount();
+    measure("colorize.lut.threaded", 1, [&]() {
+        colorLut->apply(threadedLutResult, 0);
+    }, [&]() {
+        threadedLutResult = source.copy();
+    }, details);
+
+    return vectorResult == scalarResult && threadedResult == scalarResult
+           && lutResult == scalarResult && threadedLutResult == scalarResult;
+}
+
+const QJsonArray &BenchmarkRunner::getResults() {
+    return results;
+}
@@ -0,0 +1,58 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_RUNNER_H
+#define BENCHMARK_RUNNER_H
+
+#include <functional>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+
+/*
+ * Times the hot paths of the viewer on a corpus, each one a few times over.
+ * Results are collected as JSON objects with the best and the median run, so
+ * that a warm file system cache does not hide the cold first run entirely.
+ */
+class BenchmarkRunner {
+
+public:
+    BenchmarkRunner(const QStringList &fileList, const QString &cacheDirectory, int iterations);
+
+    void benchmarkEnumeration(const QString &directory);
+
+    void benchmarkMetadata();
+
+    void benchmarkThumbnails();
+
+    bool benchmarkColorize(int width, int height);
+
+    const QJsonArray &getResults();
+
+private:
+    QStringList fileList;
+    QString cacheDirectory;
+    int iterations;
+    QJsonArray results;
+
+    /* Runs the body iterations times, prepare is not timed */
+    void measure(const QString &name, int itemsCount, std::function<void()> body,
+                 std::function<void()> prepare = nullptr, const QJsonObject &details = QJsonObject());
+};
+
+#endif // BENCHMARK_RUNNER_H
@@ -0,0 +1,167 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <exiv2/exiv2.hpp>
+#include "SyntheticCorpus.h"
+
+static const char *const corpusFormats[] = {"jpg", "png", "tiff", "webp"};
+
+static const struct {
+    const char *name;
+    int width;
+    int height;
+} corpusSizes[] = {
+        {"small",  320,  240},
+        {"medium", 1600, 1200},
+        {"large",  3000, 2000}
+};
+
+enum MetadataVariants {
+    MetadataNone = 0,
+    MetadataExif,
+    MetadataExifKeywords,
+    MetadataVariantsCount
+};
+
+static const char *const metadataVariantNames[] = {"plain", "exif", "keywords"};
+
+SyntheticCorpus::SyntheticCorpus(const QString &directory, int filesPerVariant) {
+    this->directory = directory;
+    this->filesPerVariant = filesPerVariant;
+    totalBytes = 0;
+}
+
+QImage SyntheticCorpus::createImage(int width, int height, quint32 seed) {
+    QImage image(width, height, QImage::Format_RGB32);
+
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = (QRgb *) image.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1103515245 + 12345;
+            int noise = (seed >> 16) & 31;
+            line[x] = qRgb((x * 255 / width + noise) & 255, (y * 255 / height + noise) & 255, (x + y + noise) & 255);
+        }
+    }
+
+    return image;
+}
+
+bool SyntheticCorpus::generate(QString &errorString) {
+    if (!QDir().mkpath(directory)) {
+        errorString = "Cannot create " + directory;
+        return false;
+    }
+
+    QList<QByteArray> writableFormats = QImageWriter::supportedImageFormats();
+    int orientation = 1;
+
+    for (const char *format : corpusFormats) {
+        /* WebP and TIFF writers are plugins that may be missing */
+        if (!writableFormats.contains(QByteArray(format))) {
+            skippedFormats.append(format);
+            continue;
+        }
+        formats.append(format);
+
+        for (const auto &size : corpusSizes) {
+            QImage image = createImage(size.width, size.height, (quint32) size.width);
+
+            for (int variant = MetadataNone; variant < MetadataVariantsCount; ++variant) {
+                for (int i = 0; i < filesPerVariant; ++i) {
+                    QString fileName = QString("%1/%2-%3-%4.%5").arg(directory).arg(size.name)
+                            .arg(metadataVariantNames[variant]).arg(i).arg(format);
+
+                    /* Files kept from an earlier run are reused as they are */
+                    if (!QFileInfo(fileName).exists()) {
+                        QImageWriter imageWriter(fileName, format);
+                        imageWriter.setQuality(90);
+                        if (!imageWriter.write(image)) {
+                            errorString = fileName + ": " + imageWriter.errorString();
+                            return false;
+                        }
+
+                        if (variant != MetadataNone) {
+                            QStringList keywords;
+                            if (variant == MetadataExifKeywords) {
+                                keywords << "bench" << QString("orientation %1").arg(orientation) << size.name;
+                            }
+                            if (!writeMetadata(fileName, orientation, keywords, errorString)) {
+                                errorString = fileName + ": " + errorString;
+                                return false;
+                            }
+                            orientation = orientation % 8 + 1;
+                        }
+                    }
+
+                    fileList.append(fileName);
+                    totalBytes += QFileInfo(fileName).size();
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SyntheticCorpus::writeMetadata(const QString &fileName, long orientation, const QStringList &keywords,
+                                    QString &errorString) {
+    try {
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(fileName.toStdString());
+        image->readMetadata();
+
+        Exiv2::ExifData exifData;
+        exifData["Exif.Image.Orientation"] = uint16_t(orientation);
+        exifData["Exif.Image.Software"] = "Phototonic benchmark";
+        image->setExifData(exifData);
+
+        Exiv2::IptcData iptcData;
+        for (const QString &keyword : keywords) {
+            Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::string);
+            value->read(keyword.toStdString());
+            iptcData.add(Exiv2::IptcKey("Iptc.Application2.Keywords"), value.get());
+        }
+        image->setIptcData(iptcData);
+
+        image->writeMetadata();
+    }
+    catch (Exiv2::Error &error) {
+        errorString = QString::fromUtf8(error.what());
+        return false;
+    }
+
+    return true;
+}
+
+const QStringList &SyntheticCorpus::getFileList() {
+    return fileList;
+}
+
+QJsonObject SyntheticCorpus::describe() {
+    QJsonObject corpus;
+    corpus["directory"] = directory;
+    corpus["files"] = fileList.size();
+    corpus["bytes"] = (double) totalBytes;
+    corpus["formats"] = QJsonArray::fromStringList(formats);
+    corpus["skippedFormats"] = QJsonArray::fromStringList(skippedFormats);
+    corpus["filesPerVariant"] = filesPerVariant;
+    return corpus;
+}
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETIC_CORPUS_H
+#define SYNTHETIC_CORPUS_H
+
+#include <QImage>
+#include <QStringList>
+#include <QJsonObject>
+
+/*
+ * A directory of generated images covering the formats, sizes and metadata the
+ * hot paths have to deal with: every format the Qt build can write, in three
+ * sizes, without metadata, with an Exif orientation and with Exif plus IPTC
+ * keywords. The pixels and the metadata only depend on the arguments, so two
+ * runs measure the same files.
+ */
+class SyntheticCorpus {
+
+public:
+    SyntheticCorpus(const QString &directory, int filesPerVariant);
+
+    bool generate(QString &errorString);
+
+    const QStringList &getFileList();
+
+    QJsonObject describe();
+
+    /* Gradients with some noise, so that codecs and the HSL conversion see varied pixels */
+    static QImage createImage(int width, int height, quint32 seed);
+
+private:
+    QString directory;
+    int filesPerVariant;
+    QStringList fileList;
+    QStringList formats;
+    QStringList skippedFormats;
+    qint64 totalBytes;
+
+    static bool writeMetadata(const QString &fileName, long orientation, const QStringList &keywords,
+                              QString &errorString);
+};
+
+#endif // SYNTHETIC_CORPUS_H
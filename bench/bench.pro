@@ -0,0 +1,35 @@
+#
+#  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+#  This file is part of Phototonic Image Viewer.
+#
+#  Phototonic is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  Phototonic is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Benchmarks of the hot paths on a generated image corpus, built on their own:
+# qmake && make && ./phototonic-bench [--output results.json]
+
+TEMPLATE = app
+TARGET = phototonic-bench
+INCLUDEPATH += .. /usr/local/include
+LIBS += -L/usr/local/lib -lexiv2
+QT += widgets
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+HEADERS += SyntheticCorpus.h BenchmarkRunner.h \
+			../ImageProcessor.h ../ColorizeKernel.h ../ColorLut.h ../MetadataCache.h ../MetadataIndex.h ../ThumbnailCache.h ../OrientationKernel.h \
+			../ImageHeaderParser.h ../TagDictionary.h ../XmpSidecar.h ../Settings.h
+SOURCES += main.cpp SyntheticCorpus.cpp BenchmarkRunner.cpp \
+			../ColorizeKernel.cpp ../ColorLut.cpp ../MetadataCache.cpp ../MetadataIndex.cpp ../ThumbnailCache.cpp ../OrientationKernel.cpp \
+			../ImageHeaderParser.cpp ../TagDictionary.cpp ../XmpSidecar.cpp ../Settings.cpp
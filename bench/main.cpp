@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QThread>
+#include "SyntheticCorpus.h"
+#include "BenchmarkRunner.h"
+
+#define BENCH_ITERATIONS 3
+#define BENCH_FILES_PER_VARIANT 2
+#define BENCH_COLORIZE_WIDTH 6000
+#define BENCH_COLORIZE_HEIGHT 4000
+
+int main(int argc, char *argv[]) {
+    /* No display needed, and thumbnails and the metadata index go to a scratch cache */
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QTemporaryDir cacheDir;
+    qputenv("XDG_CACHE_HOME", QFile::encodeName(cacheDir.path()));
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("phototonic-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the Phototonic hot paths on a synthetic image corpus, results are JSON");
+    parser.addHelpOption();
+    QCommandLineOption corpusOption("corpus", "Generate the corpus in DIRECTORY and keep it for later runs.",
+                                    "DIRECTORY");
+    QCommandLineOption filesOption("files-per-variant", "Files per format, size and metadata variant.", "N",
+                                   QString::number(BENCH_FILES_PER_VARIANT));
+    QCommandLineOption iterationsOption("iterations", "Runs of each benchmark.", "N",
+                                        QString::number(BENCH_ITERATIONS));
+    QCommandLineOption colorizeOption("colorize-size", "Size of the colorized image.", "WxH",
+                                      QString("%1x%2").arg(BENCH_COLORIZE_WIDTH).arg(BENCH_COLORIZE_HEIGHT));
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the results to FILE.", "FILE");
+    parser.addOptions(QList<QCommandLineOption>() << corpusOption << filesOption << iterationsOption
+                                                  << colorizeOption << outputOption);
+    parser.process(app);
+
+    QStringList colorizeSize = parser.value(colorizeOption).split('x');
+    int colorizeWidth = colorizeSize.size() == 2 ? colorizeSize.at(0).toInt() : 0;
+    int colorizeHeight = colorizeSize.size() == 2 ? colorizeSize.at(1).toInt() : 0;
+    int filesPerVariant = parser.value(filesOption).toInt();
+    if (colorizeWidth <= 0 || colorizeHeight <= 0 || filesPerVariant <= 0 || !cacheDir.isValid()) {
+        parser.showHelp(2);
+    }
+
+    QTemporaryDir corpusTemporaryDir;
+    QString corpusDirectory = parser.isSet(corpusOption) ? parser.value(corpusOption) : corpusTemporaryDir.path();
+    SyntheticCorpus corpus(corpusDirectory, filesPerVariant);
+    QString errorString;
+    if (!corpus.generate(errorString)) {
+        qCritical().noquote() << "Failed to generate the corpus:" << errorString;
+        return 2;
+    }
+
+    BenchmarkRunner runner(corpus.getFileList(), cacheDir.path(), parser.value(iterationsOption).toInt());
+    runner.benchmarkEnumeration(corpusDirectory);
+    runner.benchmarkMetadata();
+    runner.benchmarkThumbnails();
+    bool colorizeMatches = runner.benchmarkColorize(colorizeWidth, colorizeHeight);
+
+    QJsonObject system;
+    system["qt"] = qVersion();
+    system["os"] = QSysInfo::prettyProductName();
+    system["cpu"] = QSysInfo::currentCpuArchitecture();
+    system["threads"] = QThread::idealThreadCount();
+
+    QJsonObject report;
+    report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["system"] = system;
+    report["corpus"] = corpus.describe();
+    report["results"] = runner.getResults();
+    report["colorizeMatches"] = colorizeMatches;
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly) || outputFile.write(json) != json.size()) {
+            qCritical().noquote() << "Failed to write" << outputFile.fileName();
+            return 2;
+        }
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    /* The vector and threaded colorize code must produce the scalar results */
+    return colorizeMatches ? 0 : 1;
+}
@@ -17,6 +17,7 @@
  */
 
 #include "Phototonic.h"
+#include "CommandLine.h"
 #include <QApplication>
 
 static void showHelp() {
@@ -24,9 +25,18 @@ static void showHelp() {
     qInfo() << "Usage: phototonic [OPTION] [FILE... | DIRECTORY]";
     qInfo() << "  -h, --help\t\t\tshow this help and exit";
     qInfo() << "  -l, --lang=LANGUAGE\t\tstart with a specific translation";
+    qInfo() << "";
+    CommandLine::showHelp();
 }
 
 int main(int argc, char *argv[]) {
+    /* Command line mode needs no display */
+    if (argc >= 2 && CommandLine::isCommand(QString::fromLocal8Bit(argv[1]))) {
+        QCoreApplication coreApp(argc, argv);
+        CommandLine commandLine;
+        return commandLine.run(QCoreApplication::arguments());
+    }
+
     QApplication QApp(argc, argv);
     QStringList arguments = QCoreApplication::arguments();
     QLocale locale = QLocale::system();
@@ -23,14 +23,14 @@ INCLUDEPATH += /usr/local/include
 win32-g++ {
 MINGWEXIVPATH = $$PWD/mingw
 
-LIBS += -L$$MINGWEXIVPATH/lib/ -lexiv2 -lexpat -lz
+LIBS += -L$$MINGWEXIVPATH/lib/ -lexiv2 -lexpat -lz -ljpeg
 
 INCLUDEPATH += $$MINGWEXIVPATH/include
 DEPENDPATH += $$MINGWEXIVPATH/include
 
 PRE_TARGETDEPS += $$MINGWEXIVPATH/lib/libexiv2.a $$MINGWEXIVPATH/lib/libexpat.a $$MINGWEXIVPATH/lib/libz.a
 }
-else: LIBS += -L/usr/local/lib -lexiv2
+else: LIBS += -L/usr/local/lib -lexiv2 -ljpeg
 QT += widgets
 QMAKE_CXXFLAGS += $$(CXXFLAGS)
 QMAKE_CFLAGS += $$(CFLAGS)
@@ -40,13 +40,17 @@ CONFIG += c++11
 HEADERS += Phototonic.h ThumbsViewer.h ImageViewer.h CropRubberband.h SettingsDialog.h Settings.h InfoViewer.h \
 			FileSystemTree.h Bookmarks.h DirCompleter.h Tags.h MetadataCache.h ShortcutsTable.h CopyMoveDialog.h \
 			CopyMoveToDialog.h CropDialog.h ProgressDialog.h ColorsDialog.h ResizeDialog.h ExternalAppsDialog.h \
-			ImagePreview.h FileSystemModel.h FileListWidget.h RenameDialog.h Trashcan.h MessageBox.h
+			ImagePreview.h FileSystemModel.h FileListWidget.h RenameDialog.h Trashcan.h MessageBox.h \
+			ImageHeaderParser.h TagDictionary.h TagWriteQueue.h XmpSidecar.h BatchJob.h ImagePrefetcher.h ImageCache.h \
+			TiledImage.h TiledImageView.h ImageView.h ImageProcessor.h ImageLoader.h ColorizeKernel.h ColorLut.h OrientationKernel.h AnimationPlayer.h ImageSaver.h LosslessJpeg.h BatchProcessor.h BatchProcessDialog.h ThumbnailCache.h MetadataIndex.h CommandLine.h
 
 SOURCES += main.cpp Phototonic.cpp ThumbsViewer.cpp ImageViewer.cpp CropRubberband.cpp SettingsDialog.cpp \
 			Settings.cpp InfoViewer.cpp FileSystemTree.cpp Bookmarks.cpp DirCompleter.cpp Tags.cpp \
 			MetadataCache.cpp ShortcutsTable.cpp CopyMoveDialog.cpp CopyMoveToDialog.cpp CropDialog.cpp \
 			ProgressDialog.cpp ExternalAppsDialog.cpp ColorsDialog.cpp ResizeDialog.cpp ImagePreview.cpp \
-			FileSystemModel.cpp FileListWidget.cpp RenameDialog.cpp Trashcan.cpp MessageBox.cpp
+			FileSystemModel.cpp FileListWidget.cpp RenameDialog.cpp Trashcan.cpp MessageBox.cpp \
+			ImageHeaderParser.cpp TagDictionary.cpp TagWriteQueue.cpp XmpSidecar.cpp BatchJob.cpp ImagePrefetcher.cpp ImageCache.cpp \
+			TiledImage.cpp TiledImageView.cpp ImageView.cpp ImageProcessor.cpp ImageLoader.cpp ColorizeKernel.cpp ColorLut.cpp OrientationKernel.cpp AnimationPlayer.cpp ImageSaver.cpp LosslessJpeg.cpp BatchProcessor.cpp BatchProcessDialog.cpp ThumbnailCache.cpp MetadataIndex.cpp CommandLine.cpp
 
 RESOURCES += phototonic.qrc
 